@@ -11,61 +11,685 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#define GL_GLEXT_PROTOTYPES  // glGenBuffers and friends, exported by Mesa
 #include <GL/glut.h>
 #include <math.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 // Including OpenMP for parallelization
 #include <omp.h>
 
-#define board_size 256
+// size of the board and number of generations, set with -n and -i
+int board_rows = 256;
+int board_columns = 256;
+int number_of_iterations = 2000;
+int run_forever = 0;  // the window runs until it is closed unless -i is given
 
-#define number_of_iterations 2000
+// alignment (in bytes) of the board slab and of every row inside it
+#define board_alignment 64
+
+// board stored as one contiguous slab, row i starts at cells + i * stride
+typedef struct {
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board
+#define CELL(board, i, j) ((board).cells[(size_t)(i) * (board).stride + (j)])
 
 int cellSize = 4;  // Tamanho da célula em pixels
-int displaySize = board_size ;  // Tamanho da área de exibição
+int displayWidth;  // Largura da área de exibição (colunas da vista)
+int displayHeight;  // Altura da área de exibição (linhas da vista)
+#define max_display_size 256  // most cells of the view on each side
 int borderSize = 10;  // Tamanho da borda
 int barHeight = 30;  // Altura da barra superior
 int iteration = 0;  // Contador de iterações
-float **grid, **newgrid;
+Board grid, newgrid;
+
+// The simulation runs on its own thread (and the OpenMP threads it starts)
+// and hands the generations to the renderer through a triple buffer: it
+// computes into the back board while the renderer draws the front one, and
+// the newest finished generation waits in the middle. Publishing and taking
+// a board are a single atomic exchange of the middle index, so neither side
+// ever waits for the other. The finished boards are only read afterwards,
+// the simulation keeps reading its last one as the input of the next.
+Board boards[3];
+int board_iterations[3];  // generation held by each board
+#define fresh_board 4  // set in middle_board when the renderer has not taken it
+atomic_int middle_board = 2;
+int front_board = 0;
+pthread_t simulation_thread;
+
+// The board is drawn as one textured quad. Each new generation is turned
+// into one luminance byte per cell and uploaded with glTexSubImage2D from
+// one of two pixel buffer objects, taken in turns so the upload of a frame
+// does not wait for the previous one. Without OpenGL 2.1 (no pixel buffer
+// objects) the bytes are uploaded from a plain buffer.
+GLuint board_texture;
+GLuint pixel_buffers[2];
+int next_pixel_buffer = 0;
+int use_pixel_buffers = 0;
+unsigned char *pixels = NULL;  // used without pixel buffer objects
+int uploaded_iteration = -1;
+
+// The window shows a view of displayHeight x displayWidth cells of one level
+// of a pyramid: level 0 is the board, and each cell of level L covers 2x2
+// cells of level L - 1, holding the mean color of the live ones (0 when none
+// is alive, so it is also the max of their alive state). Every board of the
+// triple buffer has its pyramid, updated by the simulation before the board
+// is published, so the view of any part of a huge board is built from the
+// cells it shows only. The arrows pan the view, + and - zoom it.
+#define max_levels 32
+int levels = 1;
+int level_rows[max_levels], level_columns[max_levels];
+float *level_colors[3][max_levels];
+int view_level = 0;
+int view_row = 0, view_column = 0;  // board cell at the top left corner
+
+// The board is split in 64x64 tiles (a power of two, so the cells of the
+// first levels above a tile stay inside it). The simulation marks the tiles
+// that changed in each generation as dirty for every board, and a board
+// only updates the pyramid of its dirty tiles when it gets a new generation.
+#define tile_size 64
+int tile_rows, tile_columns;
+unsigned char *changed_tiles;
+unsigned char *dirty_tiles[3];
+
+// Headless export, set with -o: every -f generations the board is copied
+// into a ring of export_slots frames, and a writer thread turns the colors
+// into gray bytes and writes them, either to a PGM file per frame named
+// from the -o prefix or, with -o -, as a raw gray8 stream on stdout for an
+// external encoder. When the ring is full the simulation waits for the
+// writer (-p block) or the frame is dropped (-p drop).
+#define export_slots 8
+typedef struct {
+    float *cells;  // board_rows x board_columns, row after row
+    int iteration;
+} Frame;
+const char *export_path = NULL;
+int export_interval = 1;
+int drop_frames = 0;
+FILE *export_stream = NULL;  // the raw stream, when -o is -
+Frame export_ring[export_slots];
+int export_head = 0, export_count = 0, export_done = 0, dropped_frames = 0;
+pthread_mutex_t export_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t export_not_empty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t export_not_full = PTHREAD_COND_INITIALIZER;
+pthread_t writer_thread;
+
+// Mouse edits: the left button draws live cells, the right one erases them
+// and a shift click stamps a glider. The GLUT callbacks push them on a
+// lock-free queue with many producers and one consumer (a linked list
+// whose tail is swapped atomically by each push), and the simulation
+// applies them to the board it just computed, before it is published, so
+// no board is changed during a sweep or while the renderer reads it.
+#define edit_draw 0
+#define edit_erase 1
+#define edit_stamp 2
+typedef struct Edit {
+    struct Edit *_Atomic next;
+    int kind, row, column;
+} Edit;
+Edit edit_stub;  // always in the queue, so a push never finds it empty
+Edit *_Atomic edit_tail = &edit_stub;
+Edit *edit_head = &edit_stub;  // only used by the simulation
+int mouse_button = -1;  // button held while the mouse is dragged
 
 // function declarations
-float** allocate_board();
-void free_board(float **grid);
-void initialize_board(float **grid);
-void execute_iterations(float **grid, float **newgrid, int iterations);
-void compute_live_cells(float **grid);
-int get_neighbors(float **grid, int i, int j);
-float average_neighbors_value(float **grid, int i, int j);
-void show_50_50_grid(float **grid);
-void execute_single_iteration(float **grid, float **newgrid);
+Board allocate_board();
+void free_board(Board grid);
+void initialize_board(Board grid);
+void execute_iterations(Board grid, Board newgrid, int iterations);
+void compute_live_cells(Board grid);
+int get_neighbors(Board grid, int i, int j);
+float average_neighbors_value(Board grid, int i, int j);
+int get_neighbors_masked(Board grid, int i, int j);
+float average_neighbors_value_masked(Board grid, int i, int j);
+int is_power_of_two(int n);
+void parse_board_size(const char *text);
+void show_50_50_grid(Board grid);
+void execute_single_iteration(Board grid, Board newgrid);
+void *run_simulation(void *argument);
+void allocate_pyramids();
+float pool_cells(const float *colors, int rows, int columns, int stride, int i, int j);
+void update_pyramid(int b);
+void create_board_texture();
+void convert_view(int b, unsigned char *pixels);
+void upload_view(int b);
+void start_export();
+void export_board(Board board, int iteration);
+void *write_frames(void *argument);
+void finish_export();
+void push_edit(Edit *edit);
+Edit *pop_edit();
+void apply_edits(Board board);
+void edit_at(int kind, int x, int y);
+void mouse(int button, int state, int x, int y);
+void motion(int x, int y);
+void keyboard(unsigned char key, int x, int y);
+void special_keys(int key, int x, int y);
 void display_();
 
-void execute_single_iteration(float **grid, float **newgrid) {
-    #pragma omp parallel for collapse(2)
-    for (int j = 0; j < board_size; j++) {
-        for (int k = 0; k < board_size; k++) {
-            int number_of_neighbors = get_neighbors(grid, j, k);
-            if (grid[j][k] > 0.0) {
-                if (number_of_neighbors == 2 || number_of_neighbors == 3) {
-                    newgrid[j][k] = 1;
-                } else {
-                    newgrid[j][k] = 0.0;
+void execute_single_iteration(Board grid, Board newgrid) {
+    // boards with power of two sides wrap the neighbor indexes with masks
+    int power_of_two = is_power_of_two(board_rows) && is_power_of_two(board_columns);
+
+    // one tile per task, so each one marks whether it changed by itself
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int tile_i = 0; tile_i < tile_rows; tile_i++) {
+        for (int tile_j = 0; tile_j < tile_columns; tile_j++) {
+            int changed = 0;
+            int last_row = (tile_i + 1) * tile_size < board_rows ? (tile_i + 1) * tile_size : board_rows;
+            int last_column = (tile_j + 1) * tile_size < board_columns ? (tile_j + 1) * tile_size : board_columns;
+
+            for (int j = tile_i * tile_size; j < last_row; j++) {
+                for (int k = tile_j * tile_size; k < last_column; k++) {
+                    int number_of_neighbors = power_of_two ? get_neighbors_masked(grid, j, k) : get_neighbors(grid, j, k);
+                    if (CELL(grid, j, k) > 0.0) {
+                        if (number_of_neighbors == 2 || number_of_neighbors == 3) {
+                            CELL(newgrid, j, k) = 1;
+                        } else {
+                            CELL(newgrid, j, k) = 0.0;
+                        }
+                    } else {
+                        if (number_of_neighbors == 3) {
+                            CELL(newgrid, j, k) = power_of_two ? average_neighbors_value_masked(grid, j, k) : average_neighbors_value(grid, j, k);
+                        } else {
+                            CELL(newgrid, j, k) = 0.0;
+                        }
+                    }
+                    changed |= CELL(newgrid, j, k) != CELL(grid, j, k);
                 }
-            } else {
-                if (number_of_neighbors == 3) {
-                    newgrid[j][k] = average_neighbors_value(grid, j, k);
-                } else {
-                    newgrid[j][k] = 0.0;
+            }
+            changed_tiles[tile_i * tile_columns + tile_j] = changed;
+        }
+    }
+}
+
+// allocate the levels of the pyramids above the board, halving each side
+// until the whole board fits in the view
+void allocate_pyramids() {
+    level_rows[0] = board_rows;
+    level_columns[0] = board_columns;
+    while (levels < max_levels && (level_rows[levels - 1] > displayHeight || level_columns[levels - 1] > displayWidth)) {
+        level_rows[levels] = (level_rows[levels - 1] + 1) / 2;
+        level_columns[levels] = (level_columns[levels - 1] + 1) / 2;
+        levels++;
+    }
+
+    tile_rows = (board_rows + tile_size - 1) / tile_size;
+    tile_columns = (board_columns + tile_size - 1) / tile_size;
+    changed_tiles = (unsigned char *)calloc((size_t)tile_rows * tile_columns, 1);
+
+    for (int b = 0; b < 3; b++) {
+        // every tile starts dirty, so each pyramid is built whole the first time
+        dirty_tiles[b] = (unsigned char *)malloc((size_t)tile_rows * tile_columns);
+        if (changed_tiles == NULL || dirty_tiles[b] == NULL) {
+            printf("could not allocate the pyramids\n");
+            exit(1);
+        }
+        memset(dirty_tiles[b], 1, (size_t)tile_rows * tile_columns);
+
+        for (int l = 1; l < levels; l++) {
+            level_colors[b][l] = (float *)malloc((size_t)level_rows[l] * level_columns[l] * sizeof(float));
+            if (level_colors[b][l] == NULL) {
+                printf("could not allocate the pyramids\n");
+                exit(1);
+            }
+        }
+    }
+}
+
+// mean color of the live cells among the 2x2 cells under cell (i, j) of the
+// next level, or 0 when none of them is alive
+float pool_cells(const float *colors, int rows, int columns, int stride, int i, int j) {
+    float sum = 0.0;
+    int live = 0;
+
+    for (int k = 2 * i; k < 2 * i + 2 && k < rows; k++) {
+        for (int l = 2 * j; l < 2 * j + 2 && l < columns; l++) {
+            float value = colors[(size_t)k * stride + l];
+            if (value > 0.0) {
+                sum += value;
+                live++;
+            }
+        }
+    }
+    return (live > 0) ? sum / live : 0.0;
+}
+
+// Bring the pyramid of board b up to date with its cells, level after level,
+// recomputing only the cells above its dirty tiles. The levels up to the
+// tile size are split among the tiles; above it a cell covers several
+// tiles and is computed once for each of its dirty ones.
+void update_pyramid(int b) {
+    unsigned char *dirty = dirty_tiles[b];
+
+    for (int l = 1; l < levels; l++) {
+        const float *below = (l == 1) ? boards[b].cells : level_colors[b][l - 1];
+        int stride = (l == 1) ? boards[b].stride : level_columns[l - 1];
+        float *colors = level_colors[b][l];
+
+        // tiles share the cells of the levels above the tile size, so those
+        // are computed by one thread
+        #pragma omp parallel for collapse(2) schedule(dynamic) if (tile_size >> l > 0)
+        for (int tile_i = 0; tile_i < tile_rows; tile_i++) {
+            for (int tile_j = 0; tile_j < tile_columns; tile_j++) {
+                if (!dirty[tile_i * tile_columns + tile_j]) continue;
+
+                int first_row = (tile_i * tile_size) >> l;
+                int first_column = (tile_j * tile_size) >> l;
+                int last_row = ((tile_i + 1) * tile_size - 1) >> l;
+                int last_column = ((tile_j + 1) * tile_size - 1) >> l;
+                if (last_row >= level_rows[l]) last_row = level_rows[l] - 1;
+                if (last_column >= level_columns[l]) last_column = level_columns[l] - 1;
+
+                for (int i = first_row; i <= last_row; i++) {
+                    for (int j = first_column; j <= last_column; j++) {
+                        colors[(size_t)i * level_columns[l] + j] = pool_cells(below, level_rows[l - 1], level_columns[l - 1], stride, i, j);
+                    }
                 }
             }
         }
     }
+
+    memset(dirty, 0, (size_t)tile_rows * tile_columns);
+}
+
+// Compute the generations into the back board and publish each one as the
+// middle board; the previous middle becomes the next back board, since the
+// renderer holds the front one and the new middle is the next input
+void *run_simulation(void *argument) {
+    (void)argument;
+    int back = 1;
+    grid = boards[0];
+    newgrid = boards[back];
+
+    while (run_forever || iteration < number_of_iterations) {
+        execute_single_iteration(grid, newgrid);
+        apply_edits(newgrid);
+        iteration++;
+        board_iterations[back] = iteration;
+
+        // the tiles that changed are stale in every pyramid
+        for (int t = 0; t < tile_rows * tile_columns; t++) {
+            if (changed_tiles[t]) {
+                dirty_tiles[0][t] = dirty_tiles[1][t] = dirty_tiles[2][t] = 1;
+            }
+        }
+        if (export_path == NULL) {
+            update_pyramid(back);
+        } else if (iteration % export_interval == 0) {
+            export_board(newgrid, iteration);
+        }
+
+        int published = back;
+        back = atomic_exchange(&middle_board, published | fresh_board) & 3;
+        grid = boards[published];
+        newgrid = boards[back];
+    }
+    return NULL;
+}
+
+// add an edit at the end of the queue; any thread can push
+void push_edit(Edit *edit) {
+    atomic_store(&edit->next, NULL);
+    Edit *previous = atomic_exchange(&edit_tail, edit);
+    atomic_store(&previous->next, edit);
+}
+
+// Take the edit at the front of the queue, or NULL when it is empty or the
+// next edit is still being linked by a push (it is taken on the next
+// drain). The stub is pushed back when the last edit is taken, so the
+// queue never runs out of nodes.
+Edit *pop_edit() {
+    Edit *head = edit_head;
+    Edit *next = atomic_load(&head->next);
+
+    if (head == &edit_stub) {
+        if (next == NULL) return NULL;
+        edit_head = next;
+        head = next;
+        next = atomic_load(&next->next);
+    }
+    if (next != NULL) {
+        edit_head = next;
+        return head;
+    }
+    if (head != atomic_load(&edit_tail)) return NULL;
+
+    push_edit(&edit_stub);
+    next = atomic_load(&head->next);
+    if (next != NULL) {
+        edit_head = next;
+        return head;
+    }
+    return NULL;
+}
+
+// apply the queued edits to a board between two generations and mark the
+// tiles they touch as changed
+void apply_edits(Board board) {
+    // the glider of initialize_board, from the top left corner of the stamp
+    static const int glider[5][2] = {{0, 1}, {1, 2}, {2, 0}, {2, 1}, {2, 2}};
+    Edit *edit;
+
+    while ((edit = pop_edit()) != NULL) {
+        int cells = (edit->kind == edit_stamp) ? 5 : 1;
+        for (int c = 0; c < cells; c++) {
+            int i = edit->row, j = edit->column;
+            if (edit->kind == edit_stamp) {
+                i = (i + glider[c][0]) % board_rows;
+                j = (j + glider[c][1]) % board_columns;
+            }
+            CELL(board, i, j) = (edit->kind == edit_erase) ? 0.0 : 1.0;
+            changed_tiles[(i / tile_size) * tile_columns + j / tile_size] = 1;
+        }
+        free(edit);
+    }
+}
+
+// queue an edit of the board cell under the window pixel (x, y); zoomed
+// out, it is the top left cell of the block under the pixel
+void edit_at(int kind, int x, int y) {
+    int i = (y - borderSize - barHeight) / cellSize;
+    int j = (x - borderSize) / cellSize;
+    if (y < borderSize + barHeight || x < borderSize || i >= displayHeight || j >= displayWidth) return;
+
+    Edit *edit = (Edit *)malloc(sizeof(Edit));
+    if (edit == NULL) return;
+    edit->kind = kind;
+    edit->row = ((((view_row >> view_level) + i) % level_rows[view_level]) << view_level) % board_rows;
+    edit->column = ((((view_column >> view_level) + j) % level_columns[view_level]) << view_level) % board_columns;
+    push_edit(edit);
+}
+
+// the left button draws and the right one erases, also while dragged; with
+// shift the left button stamps a glider instead
+void mouse(int button, int state, int x, int y) {
+    if (state == GLUT_UP) {
+        mouse_button = -1;
+        return;
+    }
+    if (button == GLUT_LEFT_BUTTON && (glutGetModifiers() & GLUT_ACTIVE_SHIFT)) {
+        edit_at(edit_stamp, x, y);
+    } else if (button == GLUT_LEFT_BUTTON || button == GLUT_RIGHT_BUTTON) {
+        mouse_button = button;
+        edit_at((button == GLUT_LEFT_BUTTON) ? edit_draw : edit_erase, x, y);
+    }
+}
+
+void motion(int x, int y) {
+    if (mouse_button != -1) {
+        edit_at((mouse_button == GLUT_LEFT_BUTTON) ? edit_draw : edit_erase, x, y);
+    }
+}
+
+// allocate the ring of frames and start the writer thread; a raw stream
+// takes over stdout, and the messages of the program go to stderr instead
+void start_export() {
+    if (strcmp(export_path, "-") == 0) {
+        export_stream = fdopen(dup(STDOUT_FILENO), "wb");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    for (int f = 0; f < export_slots; f++) {
+        export_ring[f].cells = (float *)malloc((size_t)board_rows * board_columns * sizeof(float));
+        if (export_ring[f].cells == NULL) {
+            printf("could not allocate the frames\n");
+            exit(1);
+        }
+    }
+
+    if (pthread_create(&writer_thread, NULL, write_frames, NULL) != 0) {
+        printf("could not start the writer thread\n");
+        exit(1);
+    }
+}
+
+// Copy a board into the free slot after the last frame of the ring. The
+// simulation is the only one adding frames, so the slot is copied outside
+// the lock and the writer only sees it once it is counted.
+void export_board(Board board, int iteration) {
+    pthread_mutex_lock(&export_lock);
+    if (drop_frames && export_count == export_slots) {
+        dropped_frames++;
+        pthread_mutex_unlock(&export_lock);
+        return;
+    }
+    while (export_count == export_slots) {
+        pthread_cond_wait(&export_not_full, &export_lock);
+    }
+    Frame *frame = &export_ring[(export_head + export_count) % export_slots];
+    pthread_mutex_unlock(&export_lock);
+
+    for (int i = 0; i < board_rows; i++) {
+        memcpy(frame->cells + (size_t)i * board_columns, &CELL(board, i, 0), board_columns * sizeof(float));
+    }
+    frame->iteration = iteration;
+
+    pthread_mutex_lock(&export_lock);
+    export_count++;
+    pthread_cond_signal(&export_not_empty);
+    pthread_mutex_unlock(&export_lock);
+}
+
+// writer thread: take the frames in order, turn them into gray bytes and
+// write them until the simulation is done and the ring is empty
+void *write_frames(void *argument) {
+    (void)argument;
+    size_t size = (size_t)board_rows * board_columns;
+    unsigned char *bytes = (unsigned char *)malloc(size);
+    if (bytes == NULL) {
+        printf("could not allocate the frame bytes\n");
+        exit(1);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&export_lock);
+        while (export_count == 0 && !export_done) {
+            pthread_cond_wait(&export_not_empty, &export_lock);
+        }
+        if (export_count == 0) {
+            pthread_mutex_unlock(&export_lock);
+            break;
+        }
+        Frame *frame = &export_ring[export_head];
+        pthread_mutex_unlock(&export_lock);
+
+        for (size_t c = 0; c < size; c++) {
+            float value = frame->cells[c];
+            bytes[c] = (value >= 1.0f) ? 255 : (unsigned char)(value * 255.0f + 0.5f);
+        }
+
+        if (export_stream != NULL) {
+            fwrite(bytes, 1, size, export_stream);
+        } else {
+            char name[4096];
+            snprintf(name, sizeof(name), "%s%06d.pgm", export_path, frame->iteration);
+            FILE *file = fopen(name, "wb");
+            if (file == NULL) {
+                printf("could not write %s\n", name);
+                exit(1);
+            }
+            fprintf(file, "P5\n%d %d\n255\n", board_columns, board_rows);
+            fwrite(bytes, 1, size, file);
+            fclose(file);
+        }
+
+        pthread_mutex_lock(&export_lock);
+        export_head = (export_head + 1) % export_slots;
+        export_count--;
+        pthread_cond_signal(&export_not_full);
+        pthread_mutex_unlock(&export_lock);
+    }
+
+    free(bytes);
+    return NULL;
+}
+
+// let the writer empty the ring and wait for it
+void finish_export() {
+    pthread_mutex_lock(&export_lock);
+    export_done = 1;
+    pthread_cond_signal(&export_not_empty);
+    pthread_mutex_unlock(&export_lock);
+    pthread_join(writer_thread, NULL);
+
+    if (export_stream != NULL) {
+        fclose(export_stream);
+    }
+    for (int f = 0; f < export_slots; f++) {
+        free(export_ring[f].cells);
+    }
+    if (dropped_frames > 0) {
+        printf("dropped frames: %d\n", dropped_frames);
+    }
+}
+
+// create the texture the view is drawn from and, with OpenGL 2.1 or later,
+// the pixel buffer objects it is uploaded through
+void create_board_texture() {
+    int major = 0, minor = 0;
+    sscanf((const char *)glGetString(GL_VERSION), "%d.%d", &major, &minor);
+    use_pixel_buffers = major > 2 || (major == 2 && minor >= 1);
+
+    glGenTextures(1, &board_texture);
+    glBindTexture(GL_TEXTURE_2D, board_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, displayWidth, displayHeight, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+
+    if (use_pixel_buffers) {
+        glGenBuffers(2, pixel_buffers);
+    } else {
+        pixels = (unsigned char *)malloc((size_t)displayHeight * displayWidth);
+        if (pixels == NULL) {
+            printf("could not allocate the pixels\n");
+            exit(1);
+        }
+    }
+}
+
+// turn the colors of the view of board b into luminance bytes, row after
+// row; the view wraps around the edges of its level like the board
+void convert_view(int b, unsigned char *pixels) {
+    const float *colors = (view_level == 0) ? boards[b].cells : level_colors[b][view_level];
+    int stride = (view_level == 0) ? boards[b].stride : level_columns[view_level];
+    int rows = level_rows[view_level];
+    int columns = level_columns[view_level];
+
+    #pragma omp parallel for
+    for (int i = 0; i < displayHeight; i++) {
+        unsigned char *row = pixels + (size_t)i * displayWidth;
+        int k = ((view_row >> view_level) + i) % rows;
+        for (int j = 0; j < displayWidth; j++) {
+            int l = ((view_column >> view_level) + j) % columns;
+            float value = colors[(size_t)k * stride + l];
+            row[j] = (value >= 1.0f) ? 255 : (unsigned char)(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+// upload the view of board b to the texture; the pixel buffer is orphaned
+// before it is mapped, so the driver does not wait for a transfer still
+// reading it
+void upload_view(int b) {
+    size_t size = (size_t)displayHeight * displayWidth;
+
+    glBindTexture(GL_TEXTURE_2D, board_texture);
+    if (use_pixel_buffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffers[next_pixel_buffer]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        unsigned char *mapped = (unsigned char *)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (mapped != NULL) {
+            convert_view(b, mapped);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, displayWidth, displayHeight, GL_LUMINANCE, GL_UNSIGNED_BYTE, 0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        next_pixel_buffer = 1 - next_pixel_buffer;
+    } else {
+        convert_view(b, pixels);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, displayWidth, displayHeight, GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+    }
+}
+
+// + and - zoom in and out around the center of the view
+void keyboard(unsigned char key, int x, int y) {
+    (void)x;
+    (void)y;
+    int level = view_level;
+
+    if ((key == '+' || key == '=') && view_level > 0) {
+        level = view_level - 1;
+    } else if (key == '-' && view_level < levels - 1) {
+        level = view_level + 1;
+    }
+    if (level == view_level) return;
+
+    int center_row = view_row + (displayHeight << view_level) / 2;
+    int center_column = view_column + (displayWidth << view_level) / 2;
+    view_level = level;
+    view_row = ((center_row - (displayHeight << level) / 2) % board_rows + board_rows) % board_rows;
+    view_column = ((center_column - (displayWidth << level) / 2) % board_columns + board_columns) % board_columns;
+    uploaded_iteration = -1;
+    glutPostRedisplay();
+}
+
+// the arrows pan the view by a quarter of its size
+void special_keys(int key, int x, int y) {
+    (void)x;
+    (void)y;
+    int rows = (displayHeight << view_level) / 4;
+    int columns = (displayWidth << view_level) / 4;
+
+    if (key == GLUT_KEY_UP) view_row -= rows;
+    else if (key == GLUT_KEY_DOWN) view_row += rows;
+    else if (key == GLUT_KEY_LEFT) view_column -= columns;
+    else if (key == GLUT_KEY_RIGHT) view_column += columns;
+    else return;
+
+    view_row = (view_row % board_rows + board_rows) % board_rows;
+    view_column = (view_column % board_columns + board_columns) % board_columns;
+    uploaded_iteration = -1;
+    glutPostRedisplay();
+}
+
+// Redraw only when a new generation is waiting or the rates in the status
+// bar are due, so the renderer does not take the processors from the
+// simulation to draw the same board again
+void idle() {
+    static double last_redraw = 0.0;
+
+    if ((atomic_load(&middle_board) & fresh_board) || omp_get_wtime() - last_redraw > 0.5) {
+        last_redraw = omp_get_wtime();
+        glutPostRedisplay();
+    } else {
+        usleep(1000);
+    }
 }
 
 void display() {
+    // generations per second and frames per second over the last half second
+    static double rates_since = 0.0;
+    static int generations_since = 0, frames_since = 0;
+    static double generation_rate = 0.0, frame_rate = 0.0;
+
+    // take the newest finished generation, the old front becomes the middle
+    if (atomic_load(&middle_board) & fresh_board) {
+        front_board = atomic_exchange(&middle_board, front_board) & 3;
+    }
+    int frame_iteration = board_iterations[front_board];
+
     glClear(GL_COLOR_BUFFER_BIT);
 
     // Renderizar borda verde
@@ -73,47 +697,62 @@ void display() {
     glBegin(GL_QUADS);
     // Top border
     glVertex2i(0, 0);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, 0);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, borderSize + barHeight);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, 0);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, borderSize + barHeight);
     glVertex2i(0, borderSize + barHeight);
 
     // Bottom border
-    glVertex2i(0, displaySize * cellSize + borderSize + barHeight);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, displaySize * cellSize + borderSize + barHeight);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, displaySize * cellSize + 2 * borderSize + barHeight);
-    glVertex2i(0, displaySize * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(0, displayHeight * cellSize + borderSize + barHeight);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, displayHeight * cellSize + borderSize + barHeight);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, displayHeight * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(0, displayHeight * cellSize + 2 * borderSize + barHeight);
 
     // Left border
     glVertex2i(0, 0);
     glVertex2i(borderSize, 0);
-    glVertex2i(borderSize, displaySize * cellSize + 2 * borderSize + barHeight);
-    glVertex2i(0, displaySize * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(borderSize, displayHeight * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(0, displayHeight * cellSize + 2 * borderSize + barHeight);
 
     // Right border
-    glVertex2i(displaySize * cellSize + borderSize, 0);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, 0);
-    glVertex2i(displaySize * cellSize + 2 * borderSize, displaySize * cellSize + 2 * borderSize + barHeight);
-    glVertex2i(displaySize * cellSize + borderSize, displaySize * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(displayWidth * cellSize + borderSize, 0);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, 0);
+    glVertex2i(displayWidth * cellSize + 2 * borderSize, displayHeight * cellSize + 2 * borderSize + barHeight);
+    glVertex2i(displayWidth * cellSize + borderSize, displayHeight * cellSize + 2 * borderSize + barHeight);
     glEnd();
 
-    // Renderizar células
-    glBegin(GL_QUADS);
-    for (int i = 0; i < displaySize; i++) {
-        for (int j = 0; j < displaySize; j++) {
-            float value = grid[i][j];
-            glColor3f(value, value, value);
-            
-            glVertex2i(j * cellSize + borderSize, i * cellSize + borderSize + barHeight);
-            glVertex2i((j + 1) * cellSize + borderSize, i * cellSize + borderSize + barHeight);
-            glVertex2i((j + 1) * cellSize + borderSize, (i + 1) * cellSize + borderSize + barHeight);
-            glVertex2i(j * cellSize + borderSize, (i + 1) * cellSize + borderSize + barHeight);
-        }
+    // Renderizar células: a view is uploaded once, then drawn as one quad
+    if (frame_iteration != uploaded_iteration) {
+        upload_view(front_board);
+        uploaded_iteration = frame_iteration;
     }
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, board_texture);
+    glColor3f(1.0, 1.0, 1.0);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0, 0.0);
+    glVertex2i(borderSize, borderSize + barHeight);
+    glTexCoord2f(1.0, 0.0);
+    glVertex2i(displayWidth * cellSize + borderSize, borderSize + barHeight);
+    glTexCoord2f(1.0, 1.0);
+    glVertex2i(displayWidth * cellSize + borderSize, displayHeight * cellSize + borderSize + barHeight);
+    glTexCoord2f(0.0, 1.0);
+    glVertex2i(borderSize, displayHeight * cellSize + borderSize + barHeight);
     glEnd();
+    glDisable(GL_TEXTURE_2D);
+
+    frames_since++;
+    double now = omp_get_wtime();
+    if (now - rates_since >= 0.5) {
+        generation_rate = (frame_iteration - generations_since) / (now - rates_since);
+        frame_rate = frames_since / (now - rates_since);
+        rates_since = now;
+        generations_since = frame_iteration;
+        frames_since = 0;
+    }
 
-    // Renderizar número da iteração
-    char iterationText[50];
-    sprintf(iterationText, "Iteration: %d", iteration);
+    // Renderizar número da iteração e as taxas da simulação e do desenho
+    char iterationText[100];
+    sprintf(iterationText, "Iteration: %d  Generations/s: %.1f  FPS: %.1f  Zoom: 1/%d", frame_iteration, generation_rate, frame_rate, 1 << view_level);
     glColor3f(1.0, 1.0, 1.0);  // Cor branca para o texto
     glRasterPos2i(borderSize, barHeight - 10);  // Posição do texto
     for (char *c = iterationText; *c != '\0'; c++) {
@@ -121,16 +760,6 @@ void display() {
     }
 
     glutSwapBuffers();
-
-    execute_single_iteration(grid, newgrid);
-
-    // Swap grids
-    float **temp = grid;
-    grid = newgrid;
-    newgrid = temp;
-
-    iteration++;  // Incrementar contador de iterações
-    glutPostRedisplay();  // Redraw
 }
 
 int main(int argc, char **argv)
@@ -138,42 +767,134 @@ int main(int argc, char **argv)
     struct timeval start, finish, begin, end;
     gettimeofday(&start, NULL);
 
+    // GLUT takes its own options out of argv first, unless the run is
+    // headless and there is no display to open. getopt cannot tell yet,
+    // since GLUT options like -geometry would read as -g -e -o metry, so
+    // look for -o or -oprefix, skipping the values given after our options
+    int headless = 0;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strncmp(argv[a], "-o", 2) == 0)
+        {
+            headless = 1;
+        }
+        if (argv[a][0] == '-' && argv[a][1] != '\0' && strchr("nifpo", argv[a][1]) != NULL && argv[a][2] == '\0')
+        {
+            a++; // the value of the option
+        }
+    }
+    if (!headless)
+    {
+        glutInit(&argc, argv);
+    }
+
+    int option;
+    int iterations_given = 0;
+    while ((option = getopt(argc, argv, "n:i:o:f:p:")) != -1)
+    {
+        if (option == 'n')
+        {
+            parse_board_size(optarg);
+        }
+        else if (option == 'i' && atoi(optarg) >= 0)
+        {
+            number_of_iterations = atoi(optarg);
+            iterations_given = 1;
+        }
+        else if (option == 'o')
+        {
+            export_path = optarg;
+        }
+        else if (option == 'f' && atoi(optarg) > 0)
+        {
+            export_interval = atoi(optarg);
+        }
+        else if (option == 'p' && (strcmp(optarg, "drop") == 0 || strcmp(optarg, "block") == 0))
+        {
+            drop_frames = strcmp(optarg, "drop") == 0;
+        }
+        else
+        {
+            printf("Usage: %s [-n rows[xcolumns]] [-i iterations] [-o prefix|-] [-f interval] [-p block|drop]\n", argv[0]);
+            exit(1);
+        }
+    }
+    // like the first visualizer, the window animates until it is closed;
+    // headless runs always stop after -i generations
+    run_forever = !iterations_given && export_path == NULL;
+    displayWidth = (board_columns < max_display_size) ? board_columns : max_display_size;
+    displayHeight = (board_rows < max_display_size) ? board_rows : max_display_size;
+
     omp_set_nested(1);
 
 
-    grid = allocate_board(); // allocate board 
-    newgrid = allocate_board(); // allocate new board
+    for (int b = 0; b < 3; b++)
+    {
+        boards[b] = allocate_board(); // allocate the boards of the triple buffer
+    }
+
+    initialize_board(boards[0]); // initialize board
+
+    allocate_pyramids();
+
+    // headless: the simulation runs here and only hands boards to the writer
+    if (export_path != NULL)
+    {
+        start_export();
+        gettimeofday(&begin, NULL);
+        export_board(boards[0], 0);
+        run_simulation(NULL);
+        finish_export();
+        gettimeofday(&end, NULL);
+
+        compute_live_cells(grid);   // compute final live cells
+        for (int b = 0; b < 3; b++)
+        {
+            free_board(boards[b]); // free the boards
+        }
+
+        double running_time = (end.tv_sec - begin.tv_sec) +
+                         (end.tv_usec - begin.tv_usec) / 1000000.0;
+        printf("Running time: \t%f seconds\n", running_time);
+        return 0;
+    }
 
-    initialize_board(grid); // initialize board
+    update_pyramid(0);
 
-    glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-    glutInitWindowSize(displaySize * cellSize + 2 * borderSize, displaySize * cellSize + 2 * borderSize + barHeight);  // Ajuste o tamanho da janela
+    glutInitWindowSize(displayWidth * cellSize + 2 * borderSize, displayHeight * cellSize + 2 * borderSize + barHeight);  // Ajuste o tamanho da janela
     glutCreateWindow("Rainbow Game of Life");
-    glOrtho(0, displaySize * cellSize + 2 * borderSize, displaySize * cellSize + 2 * borderSize + barHeight, 0, -1, 1);  // Ajuste a projeção ortográfica
+    glOrtho(0, displayWidth * cellSize + 2 * borderSize, displayHeight * cellSize + 2 * borderSize + barHeight, 0, -1, 1);  // Ajuste a projeção ortográfica
+
+    create_board_texture();
 
     glutDisplayFunc(display);
+    glutIdleFunc(idle);
+    glutKeyboardFunc(keyboard);
+    glutSpecialFunc(special_keys);
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
 
-    glutMainLoop();
+    // the simulation starts on its own thread, the renderer takes its boards
+    if (pthread_create(&simulation_thread, NULL, run_simulation, NULL) != 0)
+    {
+        printf("could not start the simulation thread\n");
+        exit(1);
+    }
 
-    gettimeofday(&begin, NULL);
+    glutMainLoop();
 
-    execute_iterations(grid, newgrid, number_of_iterations); // execute iterations
+    // the window was closed: the simulation thread ran the generations
+    pthread_join(simulation_thread, NULL);
     compute_live_cells(grid);   // compute final live cells
 
-    gettimeofday(&end, NULL);
-
-    
-
-    free_board(grid); // free board
-    free_board(newgrid); // free new board
+    for (int b = 0; b < 3; b++)
+    {
+        free_board(boards[b]); // free the boards
+    }
 
     gettimeofday(&finish, NULL);
 
-    double running_time = (end.tv_sec - begin.tv_sec) +
-                     (end.tv_usec - begin.tv_usec) / 1000000.0;
-    printf("Running time: \t%f seconds\n", running_time);
-
     double elapsed = (finish.tv_sec - start.tv_sec) +
                      (finish.tv_usec - start.tv_usec) / 1000000.0;
     printf("Total time: \t%f seconds\n", elapsed);
@@ -182,68 +903,66 @@ int main(int argc, char **argv)
 }
 
 // function to allocate board
-float** allocate_board()
+Board allocate_board()
 {
-    float ** grid;
+    Board grid;
+    int floats_per_line = board_alignment / sizeof(float);
 
-    // allocate memory for the board
-    grid = (float **)malloc(board_size * sizeof(float *));
+    // round the row length up to a whole number of cache lines
+    grid.stride = (board_columns + floats_per_line - 1) / floats_per_line * floats_per_line;
 
-    #pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
+    // one aligned allocation for the whole board
+    grid.cells = (float *)aligned_alloc(board_alignment, (size_t)board_rows * grid.stride * sizeof(float));
+    if (grid.cells == NULL)
     {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+        printf("could not allocate the board\n");
+        exit(1);
     }
 
     return grid;
 }
 
 // function to free board
-void free_board(float **grid)
+void free_board(Board grid)
 {
     // free memory for the board
-    #pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
-    {
-        free(grid[i]);
-    }
-    free(grid);
+    free(grid.cells);
 }
 
 // function to initialize board
-void initialize_board(float **grid)
+void initialize_board(Board grid)
 {   
     printf("initializing board...\n");
     // clear the board
     #pragma omp parallel for
-    for(int i = 0; i < board_size; i++)
+    for(int i = 0; i < board_rows; i++)
     {
-        for(int j = 0; j < board_size; j++)
+        for(int j = 0; j < board_columns; j++)
         {
-            grid[i][j] = 0.0;
+            CELL(grid, i, j) = 0.0;
         }
     }
     printf("board cleared\n");
 
     // initialize the board from position (1,1) with glider pattern
     // and a R-pentomino pattern in (10, 30)
-    grid[1][2] = 1.0;
-    grid[2][3] = 1.0;
-    grid[3][1] = 1.0;
-    grid[3][2] = 1.0;
-    grid[3][3] = 1.0;
+    CELL(grid, 1, 2) = 1.0;
+    CELL(grid, 2, 3) = 1.0;
+    CELL(grid, 3, 1) = 1.0;
+    CELL(grid, 3, 2) = 1.0;
+    CELL(grid, 3, 3) = 1.0;
     
 
-    grid[10][31] = 1.0;
-    grid[10][32] = 1.0;
-    grid[11][30] = 1.0;
-    grid[11][31] = 1.0;
-    grid[12][31] = 1.0;
+    CELL(grid, 10, 31) = 1.0;
+    CELL(grid, 10, 32) = 1.0;
+    CELL(grid, 11, 30) = 1.0;
+    CELL(grid, 11, 31) = 1.0;
+    CELL(grid, 12, 31) = 1.0;
 
 }
 
 // function to get number of neighbors
-int get_neighbors(float **grid, int i, int j)
+int get_neighbors(Board grid, int i, int j)
 {
     // get number of neighbors
     int number_of_neighbors = 0;
@@ -264,23 +983,23 @@ int get_neighbors(float **grid, int i, int j)
 
             if(k == -1) // if k is -1, then k_aux is the last position of the board
             {
-                k_aux = board_size - 1;
+                k_aux = board_rows - 1;
             }
-            else if (k == board_size) // if k is board_size, then k_aux is the first position of the board
+            else if (k == board_rows) // if k is board_rows, then k_aux is the first position of the board
             {
                 k_aux = 0;
             }
             
             if(l == -1) // if l is -1, then l_aux is the last position of the board
             {
-                l_aux = board_size - 1;
+                l_aux = board_columns - 1;
             }
-            else if(l == board_size) // if l is board_size, then l_aux is the first position of the board
+            else if(l == board_columns) // if l is board_columns, then l_aux is the first position of the board
             {
                 l_aux = 0;
             }
 
-            if(grid[k_aux][l_aux] > 0.0) // if neighbor is alive, then increment number of neighbors
+            if(CELL(grid, k_aux, l_aux) > 0.0) // if neighbor is alive, then increment number of neighbors
             {   
                 number_of_neighbors++;
             }
@@ -291,7 +1010,7 @@ int get_neighbors(float **grid, int i, int j)
 }
 
 // function to get average of neighbors
-float average_neighbors_value(float** grid, int i,  int j)
+float average_neighbors_value(Board grid, int i,  int j)
 {
     float average = 0.0;
     
@@ -306,64 +1025,137 @@ float average_neighbors_value(float** grid, int i,  int j)
 
             if(k == -1)
             {
-                k_aux = board_size - 1;
+                k_aux = board_rows - 1;
             }
-            else if (k == board_size)
+            else if (k == board_rows)
             {
                 k_aux = 0;
             }
 
             if(l == -1){
-                l_aux = board_size - 1;
+                l_aux = board_columns - 1;
             }
-            else if(l == board_size)
+            else if(l == board_columns)
             {
                 l_aux = 0;
             }
             
-            average += (float)grid[k_aux][l_aux];  
+            average += (float)CELL(grid, k_aux, l_aux);  
         }
     }
 
     return (float)average / (float)8.0;
 }
 
+// function to get number of neighbors on a board with power of two sides:
+// the indexes wrap around with a mask instead of being compared to the edges
+int get_neighbors_masked(Board grid, int i, int j)
+{
+    int number_of_neighbors = 0;
+
+    for(int k = i - 1; k <= i + 1; k++)
+    {
+        for(int l = j - 1; l <= j + 1; l++)
+        {
+            if(k == i && l == j) // skip current cell if it is not a neighbor
+            {
+                continue;
+            }
+
+            if(CELL(grid, k & (board_rows - 1), l & (board_columns - 1)) > 0.0)
+            {
+                number_of_neighbors++;
+            }
+        }
+    }
+
+    return number_of_neighbors;
+}
+
+// function to get average of neighbors on a board with power of two sides
+float average_neighbors_value_masked(Board grid, int i, int j)
+{
+    float average = 0.0;
+
+    for(int k = i - 1; k <= i + 1; k++)
+    {
+        for(int l = j - 1; l <= j + 1; l++)
+        {
+            average += (float)CELL(grid, k & (board_rows - 1), l & (board_columns - 1));
+        }
+    }
+
+    return (float)average / (float)8.0;
+}
+
+// function to tell whether n is a power of two
+int is_power_of_two(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// function to read the board size from "rows" (a square board) or
+// "rowsxcolumns"; the initial patterns and the 50x50 corner printed for the
+// first generations need at least 50x50 cells
+void parse_board_size(const char *text)
+{
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if(fields == 1)
+    {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if(fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50)
+    {
+        printf("invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        exit(1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
 // function to execute iterations
-void execute_iterations(float **grid , float **newgrid, int iterations)
+void execute_iterations(Board grid , Board newgrid, int iterations)
 {
+    // boards with power of two sides wrap the neighbor indexes with masks
+    int power_of_two = is_power_of_two(board_rows) && is_power_of_two(board_columns);
+
     for(int i = 0; i < iterations; i++)
     {   
         #pragma omp parallel for collapse(2) // collapse to parallelize nested for loops
-        for(int j = 0; j < board_size; j++)
+        for(int j = 0; j < board_rows; j++)
         {
             
-            for(int k = 0; k < board_size; k++)
+            for(int k = 0; k < board_columns; k++)
             {
                 
                 // get neighbors
-                int number_of_neighbors = get_neighbors(grid, j, k);
+                int number_of_neighbors = power_of_two ? get_neighbors_masked(grid, j, k) : get_neighbors(grid, j, k);
 
 
-                if(grid[j][k] > 0.0)
+                if(CELL(grid, j, k) > 0.0)
                 {
                     if(number_of_neighbors == 2 || number_of_neighbors == 3)
                     {
-                        newgrid[j][k] = 1;
+                        CELL(newgrid, j, k) = 1;
                     }
                     else
                     {
-                        newgrid[j][k] = 0.0;
+                        CELL(newgrid, j, k) = 0.0;
                     }
                 }
                 else
                 {
                     if(number_of_neighbors == 3)
                     {   // calculate average of neighbors
-                        newgrid[j][k] = average_neighbors_value(grid, j, k);
+                        CELL(newgrid, j, k) = power_of_two ? average_neighbors_value_masked(grid, j, k) : average_neighbors_value(grid, j, k);
                     }
                     else
                     {
-                        newgrid[j][k] = 0.0;
+                        CELL(newgrid, j, k) = 0.0;
                     }
                 }   
             }
@@ -376,7 +1168,7 @@ void execute_iterations(float **grid , float **newgrid, int iterations)
         compute_live_cells(grid);
 
         // swap grids
-        float** temp = grid;
+        Board temp = grid;
         grid = newgrid;
         newgrid = temp;
 
@@ -389,15 +1181,15 @@ void execute_iterations(float **grid , float **newgrid, int iterations)
 }
 
 // function to compute live cells
-void compute_live_cells(float **grid)
+void compute_live_cells(Board grid)
 {
     int live_cells = 0;
     #pragma omp parallel for reduction(+:live_cells)
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 live_cells++;
             }
@@ -408,53 +1200,53 @@ void compute_live_cells(float **grid)
 }
 
 // function to show 50x50 grid
-void show_50_50_grid(float **grid)
+void show_50_50_grid(Board grid)
 {
     for (int i = 0; i < 50; i++)
     {
         for (int j = 0; j < 50; j++)
         {
-            if (grid[i][j] == 0.0)
+            if (CELL(grid, i, j) == 0.0)
             {
                 printf(". ");
             }
-            else if (grid[i][j] <= 0.0833)
+            else if (CELL(grid, i, j) <= 0.0833)
             {
                 printf(", ");
             }
-            else if (grid[i][j] <= 0.1666)
+            else if (CELL(grid, i, j) <= 0.1666)
             {
                 printf("- ");
             }
-            else if (grid[i][j] <= 0.25)
+            else if (CELL(grid, i, j) <= 0.25)
             {
                 printf("~ ");
             }
-            else if (grid[i][j] <= 0.3333)
+            else if (CELL(grid, i, j) <= 0.3333)
             {
                 printf(": ");
             }
-            else if (grid[i][j] <= 0.4166)
+            else if (CELL(grid, i, j) <= 0.4166)
             {
                 printf("; ");
             }
-            else if (grid[i][j] <= 0.5)
+            else if (CELL(grid, i, j) <= 0.5)
             {
                 printf("= ");
             }
-            else if (grid[i][j] <= 0.5833)
+            else if (CELL(grid, i, j) <= 0.5833)
             {
                 printf("! ");
             }
-            else if (grid[i][j] <= 0.6666)
+            else if (CELL(grid, i, j) <= 0.6666)
             {
                 printf("* ");
             }
-            else if (grid[i][j] <= 0.75)
+            else if (CELL(grid, i, j) <= 0.75)
             {
                 printf("# ");
             }
-            else if (grid[i][j] <= 0.8333)
+            else if (CELL(grid, i, j) <= 0.8333)
             {
                 printf("$ ");
             }
@@ -11,6 +11,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
@@ -19,18 +22,112 @@
 // Including OpenMP for parallelization
 #include <omp.h>
 
-#define board_size 2048
-#define number_of_iterations 2000
+#if defined(__x86_64__) || defined(__i386__)
+// SIMD intrinsics for the vectorized kernels
+#include <immintrin.h>
+#endif
+
+// size of the board and number of generations, set with -n and -i
+int board_rows = 2048;
+int board_columns = 2048;
+int number_of_iterations = 2000;
+
+// alignment (in bytes) of the board slab and of every row inside it
+#define board_alignment 64
+
+// columns reserved in front of every row: column 0 stays cache line aligned
+// and column -1 (the last padding float) is the left ghost column
+#define board_padding (board_alignment / (int)sizeof(float))
+
+// board stored as one contiguous slab, row i starts at cells + i * stride,
+// surrounded by a ghost ring that mirrors the opposite edges of the board
+typedef struct {
+    float *slab;
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board, -1 <= i <= board_rows and -1 <= j <= board_columns
+#define CELL(board, i, j) ((board).cells[(ptrdiff_t)(i) * (board).stride + (j)])
+
+// bit-packed occupancy plane: bit j % 64 of word j / 64 of row i tells
+// whether cell (i, j) is alive; the born plane marks the cells born in the
+// last generation, the only ones whose color is not 1.0
+typedef struct {
+    uint64_t *alive;
+    uint64_t *born;
+    int words;
+} BitPlane;
+
+// population of the generation read by the kernels and how it changes into
+// the generation they write, counted while the new generation is computed
+typedef struct {
+    int live;
+    int births;
+    int deaths;
+} Population;
+
+// print the population every report_interval generations (0: only at the end)
+int report_interval = 1;
+
+// side of the square tiles used to skip the quiet parts of the board
+#define tile_size 64
+
+// Active tiles: the board is split in tile_size x tile_size tiles and a tile
+// is only computed when it or one of its 8 neighbors changed in the previous
+// generation. Any other tile is known to stay exactly the same, and the copy
+// of it in the other grid (two generations old) is already the right one.
+typedef struct {
+    int rows;
+    int columns;
+    unsigned char *changed;
+    int *active;
+    int active_count;
+} Tiles;
+
+// compute only the active tiles instead of the whole board
+int sparse_tiles = 0;
+
+// side of the square blocks advanced several generations at a time
+#define block_size 256
+
+// generations advanced per block before moving to the next one (0: off)
+int block_depth = 0;
+
+// row kernel used for every generation, chosen at startup by select_row_kernel();
+// it computes columns [first, last) of row i of the next generation
+void (*update_row)(Board grid, Board newgrid, int i, int first, int last, Population *population);
 
 // function declarations
-float** allocate_board();
-void free_board(float **grid);
-void initialize_board(float **grid);
-void execute_iterations(float **grid, float **newgrid, int iterations);
-void compute_live_cells(float **grid);
-int get_neighbors(float **grid, int i, int j);
-float average_neighbors_value(float **grid, int i, int j);
-void show_50_50_grid(float **grid);
+Board allocate_board();
+void free_board(Board grid);
+void initialize_board(Board grid);
+void update_ghost_cells(Board grid);
+void execute_iterations(Board grid, Board newgrid, int iterations);
+void compute_live_cells(Board grid);
+void update_cells(Board grid, Board newgrid, int i, int first, int last, Population *population);
+void report_population(int i, Population population);
+Tiles allocate_tiles();
+void free_tiles(Tiles tiles);
+void update_tile(Board grid, Board newgrid, Tiles tiles, int t, Population *population);
+void select_active_tiles(Tiles *tiles);
+void select_row_kernel(const char *requested);
+Board allocate_block_buffer(int depth);
+void copy_block_in(Board grid, Board buffer, int first_row, int first_column, int height, int width, int depth);
+void advance_block(Board grid, Board newgrid, Board *buffers, int block, int generation, int depth, Population *populations);
+void execute_iterations_blocked(Board *grid_pointer, Board *newgrid_pointer, int iterations);
+void show_50_50_grid(Board grid);
+void parse_board_size(const char *text);
+BitPlane allocate_bit_plane();
+void free_bit_plane(BitPlane plane);
+float bit_cell_color(BitPlane plane, Board colors, int i, int j);
+static inline uint64_t west_word(const uint64_t *row, int w, int words, int power_of_two);
+static inline uint64_t east_word(const uint64_t *row, int w, int words, int power_of_two);
+void full_adder(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum, uint64_t *carry);
+static inline __attribute__((always_inline)) void update_bit_row(BitPlane plane, BitPlane next, Board colors, int i, Population *population, int power_of_two);
+int is_power_of_two(int n);
+void bit_plane_to_board(BitPlane plane, Board colors, Board grid);
+void execute_iterations_bits(Board grid, Board newgrid, int iterations);
 
 int main(int argc, char **argv)
 {   
@@ -39,7 +136,62 @@ int main(int argc, char **argv)
 
     omp_set_nested(1);
 
-    float **grid, **newgrid; // board and new board
+    const char *kernel = NULL; // row kernel, NULL picks the widest one available
+    const char *engine = "float"; // float board or bit-packed planes
+    int option;
+    while ((option = getopt(argc, argv, "k:e:r:st:n:i:")) != -1)
+    {
+        if (option == 'k')
+        {
+            kernel = optarg;
+        }
+        else if (option == 'e' && (strcmp(optarg, "float") == 0 || strcmp(optarg, "bits") == 0))
+        {
+            engine = optarg;
+        }
+        else if (option == 'r' && atoi(optarg) >= 0)
+        {
+            report_interval = atoi(optarg);
+        }
+        else if (option == 's')
+        {
+            sparse_tiles = 1;
+        }
+        else if (option == 't' && atoi(optarg) >= 0)
+        {
+            block_depth = atoi(optarg);
+        }
+        else if (option == 'n')
+        {
+            parse_board_size(optarg);
+        }
+        else if (option == 'i' && atoi(optarg) >= 0)
+        {
+            number_of_iterations = atoi(optarg);
+        }
+        else
+        {
+            printf("Usage: %s [-k scalar|avx2|avx512] [-e float|bits] [-r report interval] [-s] [-t block depth] [-n rows[xcolumns]] [-i iterations]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    if (block_depth > 0 && (sparse_tiles || strcmp(engine, "bits") == 0))
+    {
+        printf("temporal blocking (-t) only runs on the float engine without -s\n");
+        exit(1);
+    }
+
+    if (strcmp(engine, "bits") == 0)
+    {
+        printf("engine: bits\n");
+    }
+    else
+    {
+        select_row_kernel(kernel);
+    }
+
+    Board grid, newgrid; // board and new board
 
     grid = allocate_board(); // allocate board 
     newgrid = allocate_board(); // allocate new board
@@ -48,7 +200,19 @@ int main(int argc, char **argv)
 
     gettimeofday(&begin, NULL);
 
-    execute_iterations(grid, newgrid, number_of_iterations); // execute iterations
+    // execute iterations
+    if (strcmp(engine, "bits") == 0)
+    {
+        execute_iterations_bits(grid, newgrid, number_of_iterations);
+    }
+    else if (block_depth > 0)
+    {
+        execute_iterations_blocked(&grid, &newgrid, number_of_iterations);
+    }
+    else
+    {
+        execute_iterations(grid, newgrid, number_of_iterations);
+    }
     compute_live_cells(grid);   // compute final live cells
 
     gettimeofday(&end, NULL);
@@ -70,221 +234,979 @@ int main(int argc, char **argv)
 }
 
 // function to allocate board
-float** allocate_board()
+Board allocate_board()
 {
-    float ** grid;
+    Board grid;
+    int floats_per_line = board_alignment / sizeof(float);
 
-    // allocate memory for the board
-    grid = (float **)malloc(board_size * sizeof(float *));
+    // padding + row + right ghost column, rounded up to whole cache lines
+    grid.stride = (board_padding + board_columns + 1 + floats_per_line - 1) / floats_per_line * floats_per_line;
 
-    #pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
+    // one aligned allocation for the whole board plus the two ghost rows
+    grid.slab = (float *)aligned_alloc(board_alignment, (size_t)(board_rows + 2) * grid.stride * sizeof(float));
+    if (grid.slab == NULL)
     {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+        printf("could not allocate the board\n");
+        exit(1);
     }
+    grid.cells = grid.slab + grid.stride + board_padding;
 
     return grid;
 }
 
 // function to free board
-void free_board(float **grid)
+void free_board(Board grid)
 {
     // free memory for the board
-    #pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
-    {
-        free(grid[i]);
-    }
-    free(grid);
+    free(grid.slab);
 }
 
 // function to initialize board
-void initialize_board(float **grid)
+void initialize_board(Board grid)
 {   
     printf("initializing board...\n");
     // clear the board
     #pragma omp parallel for
-    for(int i = 0; i < board_size; i++)
+    for(int i = 0; i < board_rows; i++)
     {
-        for(int j = 0; j < board_size; j++)
+        for(int j = 0; j < board_columns; j++)
         {
-            grid[i][j] = 0.0;
+            CELL(grid, i, j) = 0.0;
         }
     }
     printf("board cleared\n");
 
     // initialize the board from position (1,1) with glider pattern
     // and a R-pentomino pattern in (10, 30)
-    grid[1][2] = 1.0;
-    grid[2][3] = 1.0;
-    grid[3][1] = 1.0;
-    grid[3][2] = 1.0;
-    grid[3][3] = 1.0;
+    CELL(grid, 1, 2) = 1.0;
+    CELL(grid, 2, 3) = 1.0;
+    CELL(grid, 3, 1) = 1.0;
+    CELL(grid, 3, 2) = 1.0;
+    CELL(grid, 3, 3) = 1.0;
+
+    CELL(grid, 10, 31) = 1.0;
+    CELL(grid, 10, 32) = 1.0;
+    CELL(grid, 11, 30) = 1.0;
+    CELL(grid, 11, 31) = 1.0;
+    CELL(grid, 12, 31) = 1.0;
+
+}
+
+// function to copy the opposite edges of the board into the ghost ring
+void update_ghost_cells(Board grid)
+{
+    // left and right ghost columns
+    #pragma omp parallel for
+    for (int i = 0; i < board_rows; i++)
+    {
+        CELL(grid, i, -1) = CELL(grid, i, board_columns - 1);
+        CELL(grid, i, board_columns) = CELL(grid, i, 0);
+    }
+
+    // upper and lower ghost rows, corners included
+    memcpy(&CELL(grid, -1, -1), &CELL(grid, board_rows - 1, -1), (board_columns + 2) * sizeof(float));
+    memcpy(&CELL(grid, board_rows, -1), &CELL(grid, 0, -1), (board_columns + 2) * sizeof(float));
+}
+
+// function to compute columns [first, last) of row i of the next generation
+// in a single pass. The 3x3 window is kept as three vertical sums (live count
+// and color sum of columns j - 1, j and j + 1); moving one cell to the right
+// reuses two of them, so each cell loads only the three floats of column j + 1.
+// The population counts of the range are added to population.
+void update_cells(Board grid, Board newgrid, int i, int first, int last, Population *population)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    // vertical sums of columns first - 1 and first (the ghost ring makes -1 valid)
+    int left_count = (up[first - 1] > 0.0) + (middle[first - 1] > 0.0) + (down[first - 1] > 0.0);
+    float left_sum = up[first - 1] + middle[first - 1] + down[first - 1];
+    int center_count = (up[first] > 0.0) + (middle[first] > 0.0) + (down[first] > 0.0);
+    float center_sum = up[first] + middle[first] + down[first];
+
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < last; j++)
+    {
+        // vertical sums of the column entering the window
+        int right_count = (up[j + 1] > 0.0) + (middle[j + 1] > 0.0) + (down[j + 1] > 0.0);
+        float right_sum = up[j + 1] + middle[j + 1] + down[j + 1];
+
+        int alive = middle[j] > 0.0;
+        int number_of_neighbors = left_count + center_count + right_count - alive;
+
+        if (alive)
+        {
+            // survives with 2 or 3 neighbors
+            int survives = number_of_neighbors == 2 || number_of_neighbors == 3;
+            next[j] = survives ? 1.0 : 0.0;
+            deaths += !survives;
+        }
+        else
+        {
+            // born with 3 neighbors, colored by the average of the 3x3 block
+            int born = number_of_neighbors == 3;
+            next[j] = born ? (left_sum + center_sum + right_sum) / (float)8.0 : 0.0;
+            births += born;
+        }
+        live += alive;
+
+        // slide the window one column to the right
+        left_count = center_count;
+        left_sum = center_sum;
+        center_count = right_count;
+        center_sum = right_sum;
+    }
+
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// function to compute columns [first, last) of row i of the next generation
+// 8 cells at a time with AVX2.
+// Each lane holds one cell: the alive masks come from compares against 0.0,
+// the neighbor counts from adding the masked 1.0s of the 3x3 window, and the
+// survive/birth/die outcome is selected with blends, the birth color being
+// computed in the same lanes.
+__attribute__((target("avx2")))
+void update_row_avx2(Board grid, Board newgrid, int i, int first, int last, Population *population)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 eighth = _mm256_set1_ps(0.125f);
+
+    int vector_end = last - (last - first) % 8;
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < vector_end; j += 8)
+    {
+        // vertical color sums and live counts of columns j - 1, j and j + 1
+        __m256 sum[3];
+        __m256 count[3];
+        for (int c = 0; c < 3; c++)
+        {
+            __m256 u = _mm256_loadu_ps(up + j + c - 1);
+            __m256 m = _mm256_loadu_ps(middle + j + c - 1);
+            __m256 d = _mm256_loadu_ps(down + j + c - 1);
+
+            sum[c] = _mm256_add_ps(_mm256_add_ps(u, m), d);
+            count[c] = _mm256_add_ps(_mm256_add_ps(_mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ), one),
+                                                   _mm256_and_ps(_mm256_cmp_ps(m, zero, _CMP_GT_OQ), one)),
+                                     _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), one));
+        }
+
+        __m256 cell = _mm256_loadu_ps(middle + j);
+        __m256 alive = _mm256_cmp_ps(cell, zero, _CMP_GT_OQ);
+
+        // the window count includes the cell itself
+        __m256 neighbors = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(count[0], count[1]), count[2]),
+                                         _mm256_and_ps(alive, one));
+        __m256 has_two = _mm256_cmp_ps(neighbors, two, _CMP_EQ_OQ);
+        __m256 has_three = _mm256_cmp_ps(neighbors, three, _CMP_EQ_OQ);
+
+        __m256 survive = _mm256_and_ps(alive, _mm256_or_ps(has_two, has_three));
+        __m256 birth = _mm256_andnot_ps(alive, has_three);
+        __m256 average = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(sum[0], sum[1]), sum[2]), eighth);
+
+        // die -> 0.0, birth -> average, survive -> 1.0
+        __m256 result = _mm256_blendv_ps(zero, average, birth);
+        result = _mm256_blendv_ps(result, one, survive);
+        _mm256_storeu_ps(next + j, result);
 
-    grid[10][31] = 1.0;
-    grid[10][32] = 1.0;
-    grid[11][30] = 1.0;
-    grid[11][31] = 1.0;
-    grid[12][31] = 1.0;
+        // population counts from the lane masks
+        int alive_lanes = _mm256_movemask_ps(alive);
+        live += __builtin_popcount(alive_lanes);
+        births += __builtin_popcount(_mm256_movemask_ps(birth));
+        deaths += __builtin_popcount(alive_lanes & ~_mm256_movemask_ps(survive));
+    }
+
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
+
+    // cells left over when the range is not a multiple of the vector width
+    // the scalar kernel is plain SSE code: clear the upper halves of the
+    // vector registers first or every one of its instructions pays for them
+    _mm256_zeroupper();
+    update_cells(grid, newgrid, i, vector_end, last, population);
+}
+
+// function to compute columns [first, last) of row i of the next generation
+// 16 cells at a time with AVX-512, same scheme as the AVX2 kernel but with
+// mask registers
+__attribute__((target("avx512f")))
+void update_row_avx512(Board grid, Board newgrid, int i, int first, int last, Population *population)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+    const __m512 eighth = _mm512_set1_ps(0.125f);
+
+    int vector_end = last - (last - first) % 16;
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < vector_end; j += 16)
+    {
+        __m512 sum[3];
+        __m512 count[3];
+        for (int c = 0; c < 3; c++)
+        {
+            __m512 u = _mm512_loadu_ps(up + j + c - 1);
+            __m512 m = _mm512_loadu_ps(middle + j + c - 1);
+            __m512 d = _mm512_loadu_ps(down + j + c - 1);
+
+            sum[c] = _mm512_add_ps(_mm512_add_ps(u, m), d);
+            count[c] = _mm512_add_ps(_mm512_add_ps(_mm512_maskz_mov_ps(_mm512_cmp_ps_mask(u, zero, _CMP_GT_OQ), one),
+                                                   _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(m, zero, _CMP_GT_OQ), one)),
+                                     _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ), one));
+        }
+
+        __m512 cell = _mm512_loadu_ps(middle + j);
+        __mmask16 alive = _mm512_cmp_ps_mask(cell, zero, _CMP_GT_OQ);
+
+        __m512 neighbors = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(count[0], count[1]), count[2]),
+                                         _mm512_maskz_mov_ps(alive, one));
+        __mmask16 has_two = _mm512_cmp_ps_mask(neighbors, two, _CMP_EQ_OQ);
+        __mmask16 has_three = _mm512_cmp_ps_mask(neighbors, three, _CMP_EQ_OQ);
+
+        __mmask16 survive = alive & (has_two | has_three);
+        __mmask16 birth = ~alive & has_three;
+        __m512 average = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(sum[0], sum[1]), sum[2]), eighth);
+
+        __m512 result = _mm512_maskz_mov_ps(birth, average);
+        result = _mm512_mask_blend_ps(survive, result, one);
+        _mm512_storeu_ps(next + j, result);
+
+        live += __builtin_popcount(alive);
+        births += __builtin_popcount(birth);
+        deaths += __builtin_popcount(alive & ~survive);
+    }
+
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
+
+    // the scalar kernel is plain SSE code: clear the upper halves of the
+    // vector registers first or every one of its instructions pays for them
+    _mm256_zeroupper();
+    update_cells(grid, newgrid, i, vector_end, last, population);
+}
+#endif
+
+// function to pick the row kernel at startup: the widest one this CPU
+// supports, or the one requested on the command line
+void select_row_kernel(const char *requested)
+{
+    const char *name = "scalar";
+    int has_avx2 = 0;
+    int has_avx512 = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    // CPUID based feature detection
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2");
+    has_avx512 = __builtin_cpu_supports("avx512f");
+#endif
+
+    if (requested == NULL)
+    {
+        requested = has_avx512 ? "avx512" : has_avx2 ? "avx2" : "scalar";
+    }
+
+    update_row = update_cells;
+#if defined(__x86_64__) || defined(__i386__)
+    if (strcmp(requested, "avx512") == 0 && has_avx512)
+    {
+        name = "avx512";
+        update_row = update_row_avx512;
+    }
+    else if (strcmp(requested, "avx2") == 0 && has_avx2)
+    {
+        name = "avx2";
+        update_row = update_row_avx2;
+    }
+#endif
+
+    if (strcmp(requested, name) != 0)
+    {
+        printf("%s kernel not available on this CPU\n", requested);
+    }
+    printf("row kernel: %s\n", name);
+}
+
+// function to print the population of generation i and its changes
+void report_population(int i, Population population)
+{
+    printf("iteration: %d live cells: %d births: %d deaths: %d\n", i, population.live, population.births, population.deaths);
+}
+
+// function to allocate the tiles of the board, all of them active at first
+Tiles allocate_tiles()
+{
+    Tiles tiles;
+
+    tiles.rows = (board_rows + tile_size - 1) / tile_size;
+    tiles.columns = (board_columns + tile_size - 1) / tile_size;
+    int count = tiles.rows * tiles.columns;
+
+    tiles.changed = (unsigned char *)malloc(count * sizeof(unsigned char));
+    tiles.active = (int *)malloc(count * sizeof(int));
+    if (tiles.changed == NULL || tiles.active == NULL)
+    {
+        printf("could not allocate the tiles\n");
+        exit(1);
+    }
+
+    memset(tiles.changed, 1, count * sizeof(unsigned char));
+    select_active_tiles(&tiles);
+
+    return tiles;
+}
 
+// function to free the tiles
+void free_tiles(Tiles tiles)
+{
+    free(tiles.changed);
+    free(tiles.active);
 }
 
-// function to get number of neighbors
-int get_neighbors(float **grid, int i, int j)
+// function to compute the next generation of tile t, recording whether any
+// of its cells changed (compared while the rows are still in cache)
+void update_tile(Board grid, Board newgrid, Tiles tiles, int t, Population *population)
 {
-    // get number of neighbors
-    int number_of_neighbors = 0;
+    int first_row = t / tiles.columns * tile_size;
+    int first_column = t % tiles.columns * tile_size;
+    int last_row = (first_row + tile_size < board_rows) ? first_row + tile_size : board_rows;
+    int last_column = (first_column + tile_size < board_columns) ? first_column + tile_size : board_columns;
+    int changed = 0;
 
-    // check neighbors
-    for(int k = i - 1; k <= i + 1; k++)
+    for (int i = first_row; i < last_row; i++)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
-            // get neighbors
-            int k_aux = k;
-            int l_aux = l;
+        update_row(grid, newgrid, i, first_column, last_column, population);
+        changed |= memcmp(&CELL(grid, i, first_column), &CELL(newgrid, i, first_column),
+                          (last_column - first_column) * sizeof(float)) != 0;
+    }
 
-            if(k == i && l == j) // skip current cell if it is not a neighbor
+    tiles.changed[t] = changed;
+}
+
+// function to list the tiles to compute in the next generation: the ones
+// with a changed tile around them (the board wraps around for tiles too)
+void select_active_tiles(Tiles *tiles)
+{
+    int rows = tiles->rows;
+    int columns = tiles->columns;
+
+    tiles->active_count = 0;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int active = 0;
+            for (int k = -1; k <= 1; k++)
             {
-                continue;
+                for (int l = -1; l <= 1; l++)
+                {
+                    active |= tiles->changed[(row + k + rows) % rows * columns + (column + l + columns) % columns];
+                }
             }
 
-            if(k == -1) // if k is -1, then k_aux is the last position of the board
+            if (active)
             {
-                k_aux = board_size - 1;
+                tiles->active[tiles->active_count++] = row * columns + column;
             }
-            else if (k == board_size) // if k is board_size, then k_aux is the first position of the board
+        }
+    }
+
+    // the tiles left out do not change, the others set their flag again
+    memset(tiles->changed, 0, rows * columns * sizeof(unsigned char));
+}
+
+// function to execute iterations
+void execute_iterations(Board grid , Board newgrid, int iterations)
+{
+    Population population = {0, 0, 0};
+    Tiles tiles;
+
+    if(sparse_tiles)
+    {
+        tiles = allocate_tiles();
+    }
+
+    for(int i = 0; i < iterations; i++)
+    {   
+        // refresh the ghost ring from the current generation
+        update_ghost_cells(grid);
+
+        // the kernels count the population while they sweep the board, each
+        // thread adds up its rows and OpenMP combines the totals at the end
+        int live = 0, births = 0, deaths = 0;
+        if(sparse_tiles)
+        {
+            // only the active tiles, handed out dynamically since the
+            // edge tiles may be narrower than the others
+            #pragma omp parallel for schedule(dynamic) reduction(+:live, births, deaths)
+            for(int a = 0; a < tiles.active_count; a++)
             {
-                k_aux = 0;
+                Population tile = {0, 0, 0};
+                update_tile(grid, newgrid, tiles, tiles.active[a], &tile);
+                live += tile.live;
+                births += tile.births;
+                deaths += tile.deaths;
             }
-            
-            if(l == -1) // if l is -1, then l_aux is the last position of the board
+            select_active_tiles(&tiles);
+
+            // the skipped tiles keep their live cells: after the first
+            // generation (all tiles active) the count is carried over
+            if(i > 0)
             {
-                l_aux = board_size - 1;
+                live = population.live + population.births - population.deaths;
             }
-            else if(l == board_size) // if l is board_size, then l_aux is the first position of the board
+        }
+        else
+        {
+            #pragma omp parallel for reduction(+:live, births, deaths) // rows are independent, each one is swept left to right
+            for(int j = 0; j < board_rows; j++)
             {
-                l_aux = 0;
+                Population row = {0, 0, 0};
+                update_row(grid, newgrid, j, 0, board_columns, &row);
+                live += row.live;
+                births += row.births;
+                deaths += row.deaths;
             }
+        }
+        population.live = live;
+        population.births = births;
+        population.deaths = deaths;
 
-            if(grid[k_aux][l_aux] > 0.0) // if neighbor is alive, then increment number of neighbors
-            {   
-                number_of_neighbors++;
-            }
+        // print iteration
+        if(report_interval > 0 && i % report_interval == 0)
+        {
+            report_population(i, population);
+        }
+
+        // swap grids
+        Board temp = grid;
+        grid = newgrid;
+        newgrid = temp;
+
+        if(i < 5)
+        {
+            show_50_50_grid(grid);
         }
     }
 
-    return number_of_neighbors;
+    // population of the last generation
+    if(iterations > 0)
+    {
+        printf("live cells: %d\n", population.live + population.births - population.deaths);
+    }
+    else
+    {
+        compute_live_cells(grid);
+    }
+
+    if(sparse_tiles)
+    {
+        free_tiles(tiles);
+    }
 }
 
-// function to get average of neighbors
-float average_neighbors_value(float** grid, int i,  int j)
+// function to allocate the private buffer of a block with a halo of depth
+// cells on every side; it has no ghost ring, the halo takes its place
+Board allocate_block_buffer(int depth)
 {
-    float average = 0.0;
-    
-    // get average of neighbors
-    for(int k = i - 1; k <= i + 1; k++)
+    Board buffer;
+    int floats_per_line = board_alignment / sizeof(float);
+    int side = block_size + 2 * depth;
+
+    buffer.stride = (side + floats_per_line - 1) / floats_per_line * floats_per_line;
+    buffer.slab = (float *)aligned_alloc(board_alignment, (size_t)side * buffer.stride * sizeof(float));
+    if (buffer.slab == NULL)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
+        printf("could not allocate the block buffers\n");
+        exit(1);
+    }
+    buffer.cells = buffer.slab;
 
-            int k_aux = k;
-            int l_aux = l;
+    return buffer;
+}
 
-            if(k == -1)
+// function to copy the block starting at (first_row, first_column) and its
+// halo of depth cells into the buffer, wrapping around the board edges
+void copy_block_in(Board grid, Board buffer, int first_row, int first_column, int height, int width, int depth)
+{
+    for (int r = 0; r < height + 2 * depth; r++)
+    {
+        int row = ((first_row - depth + r) % board_rows + board_rows) % board_rows;
+
+        // the halo may cross the left or right edge, copy the row in pieces
+        for (int j = 0; j < width + 2 * depth; )
+        {
+            int column = ((first_column - depth + j) % board_columns + board_columns) % board_columns;
+            int count = width + 2 * depth - j;
+            if (count > board_columns - column)
             {
-                k_aux = board_size - 1;
+                count = board_columns - column;
             }
-            else if (k == board_size)
+            memcpy(&CELL(buffer, r, j), &CELL(grid, row, column), count * sizeof(float));
+            j += count;
+        }
+    }
+}
+
+// function to advance one block depth generations inside the two private
+// buffers. Generation k is computed on the block plus a halo of depth - k - 1
+// cells, which still has valid neighbors, so after depth generations the
+// block itself is exact and goes to newgrid. Only the cells of the block are
+// counted in populations[k], the halo is counted by the neighbor blocks; as
+// that splits every row in three, it is only done for the generations that
+// are reported (and for single generation steps, which end the run).
+void advance_block(Board grid, Board newgrid, Board *buffers, int block, int generation, int depth, Population *populations)
+{
+    int block_columns = (board_columns + block_size - 1) / block_size;
+    int first_row = block / block_columns * block_size;
+    int first_column = block % block_columns * block_size;
+    int height = (first_row + block_size < board_rows) ? block_size : board_rows - first_row;
+    int width = (first_column + block_size < board_columns) ? block_size : board_columns - first_column;
+    int side_rows = height + 2 * depth;
+    int side_columns = width + 2 * depth;
+
+    Board from = buffers[0];
+    Board to = buffers[1];
+    copy_block_in(grid, from, first_row, first_column, height, width, depth);
+
+    for (int k = 0; k < depth; k++)
+    {
+        Population halo = {0, 0, 0};
+        int counted = depth == 1 || (report_interval > 0 && (generation + k) % report_interval == 0);
+        for (int r = k + 1; r < side_rows - k - 1; r++)
+        {
+            if (counted && r >= depth && r < depth + height)
+            {
+                update_row(from, to, r, k + 1, depth, &halo);
+                update_row(from, to, r, depth, depth + width, &populations[k]);
+                update_row(from, to, r, depth + width, side_columns - k - 1, &halo);
+            }
+            else
             {
-                k_aux = 0;
+                update_row(from, to, r, k + 1, side_columns - k - 1, &halo);
             }
+        }
+
+        Board temp = from;
+        from = to;
+        to = temp;
+    }
+
+    for (int r = 0; r < height; r++)
+    {
+        memcpy(&CELL(newgrid, first_row + r, first_column), &CELL(from, depth + r, depth), width * sizeof(float));
+    }
+}
+
+// function to execute iterations with temporal blocking: every block is read
+// once, advanced block_depth generations while it sits in the cache and
+// written once, instead of streaming both boards through memory every generation
+void execute_iterations_blocked(Board *grid_pointer, Board *newgrid_pointer, int iterations)
+{
+    Board grid = *grid_pointer;
+    Board newgrid = *newgrid_pointer;
+    int blocks = (board_rows + block_size - 1) / block_size * ((board_columns + block_size - 1) / block_size);
+    int threads = omp_get_max_threads();
+    Population population = {0, 0, 0};
+    int swaps = 0;
+
+    // two buffers per thread, allocated once for the whole run
+    Board *buffers = (Board *)malloc(2 * threads * sizeof(Board));
+    int *live = (int *)malloc(block_depth * sizeof(int));
+    int *births = (int *)malloc(block_depth * sizeof(int));
+    int *deaths = (int *)malloc(block_depth * sizeof(int));
+    if (buffers == NULL || live == NULL || births == NULL || deaths == NULL)
+    {
+        printf("could not allocate the block buffers\n");
+        exit(1);
+    }
+    for (int t = 0; t < 2 * threads; t++)
+    {
+        buffers[t] = allocate_block_buffer(block_depth);
+    }
+
+    for (int i = 0; i < iterations; )
+    {
+        // the first generations are shown one by one, and the last one is
+        // computed alone so the other grid keeps the generation before it
+        int depth = (i < 5) ? 1 : block_depth;
+        if (depth >= iterations - i)
+        {
+            depth = (iterations - i > 1) ? iterations - i - 1 : 1;
+        }
 
-            if(l == -1){
-                l_aux = board_size - 1;
+        memset(live, 0, depth * sizeof(int));
+        memset(births, 0, depth * sizeof(int));
+        memset(deaths, 0, depth * sizeof(int));
+
+        #pragma omp parallel for schedule(dynamic) reduction(+:live[:depth], births[:depth], deaths[:depth])
+        for (int block = 0; block < blocks; block++)
+        {
+            Population populations[depth];
+            memset(populations, 0, sizeof(populations));
+
+            advance_block(grid, newgrid, &buffers[2 * omp_get_thread_num()], block, i, depth, populations);
+            for (int k = 0; k < depth; k++)
+            {
+                live[k] += populations[k].live;
+                births[k] += populations[k].births;
+                deaths[k] += populations[k].deaths;
             }
-            else if(l == board_size)
+        }
+
+        for (int k = 0; k < depth; k++, i++)
+        {
+            population.live = live[k];
+            population.births = births[k];
+            population.deaths = deaths[k];
+
+            // print iteration
+            if(report_interval > 0 && i % report_interval == 0)
             {
-                l_aux = 0;
+                report_population(i, population);
             }
-            
-            average += (float)grid[k_aux][l_aux];  
+        }
+
+        // swap grids, newgrid is now depth generations ahead
+        Board temp = grid;
+        grid = newgrid;
+        newgrid = temp;
+        swaps++;
+
+        if(i <= 5)
+        {
+            show_50_50_grid(grid);
         }
     }
 
-    return (float)average / (float)8.0;
+    // population of the last generation
+    if(iterations > 0)
+    {
+        printf("live cells: %d\n", population.live + population.births - population.deaths);
+    }
+    else
+    {
+        compute_live_cells(grid);
+    }
+
+    // hand the caller the last two generations in the grids they would be
+    // in after one swap per generation, swapping its boards, not the cells
+    if ((swaps - iterations) % 2 != 0)
+    {
+        Board temp = *grid_pointer;
+        *grid_pointer = *newgrid_pointer;
+        *newgrid_pointer = temp;
+    }
+
+    for (int t = 0; t < 2 * threads; t++)
+    {
+        free_board(buffers[t]);
+    }
+    free(buffers);
+    free(live);
+    free(births);
+    free(deaths);
 }
 
-// function to execute iterations
-void execute_iterations(float **grid , float **newgrid, int iterations)
+// function to allocate one bit plane, one bit per cell and whole words per row
+BitPlane allocate_bit_plane()
 {
-    for(int i = 0; i < iterations; i++)
-    {   
-        #pragma omp parallel for collapse(2) // collapse to parallelize nested for loops
-        for(int j = 0; j < board_size; j++)
+    BitPlane plane;
+
+    plane.words = (board_columns + 63) / 64;
+    size_t bytes = (size_t)board_rows * plane.words * sizeof(uint64_t);
+    bytes = (bytes + board_alignment - 1) / board_alignment * board_alignment;
+
+    plane.alive = (uint64_t *)aligned_alloc(board_alignment, bytes);
+    plane.born = (uint64_t *)aligned_alloc(board_alignment, bytes);
+    if (plane.alive == NULL || plane.born == NULL)
+    {
+        printf("could not allocate the bit plane\n");
+        exit(1);
+    }
+
+    return plane;
+}
+
+// function to free a bit plane
+void free_bit_plane(BitPlane plane)
+{
+    free(plane.alive);
+    free(plane.born);
+}
+
+// function to get the color of cell (i, j) out of the bit plane and the color
+// plane: dead cells are 0.0, survivors 1.0, and only the cells born in the
+// last generation keep their color in the color plane
+float bit_cell_color(BitPlane plane, Board colors, int i, int j)
+{
+    size_t word = (size_t)i * plane.words + j / 64;
+    uint64_t bit = (uint64_t)1 << (j % 64);
+
+    if (!(plane.alive[word] & bit))
+    {
+        return 0.0;
+    }
+    return (plane.born[word] & bit) ? CELL(colors, i, j) : 1.0;
+}
+
+// function to get a word of a bit row shifted so that bit b holds the cell
+// west (left) of the cell of bit b, wrapping around the board
+static inline uint64_t west_word(const uint64_t *row, int w, int words, int power_of_two)
+{
+    // a power of two row is made of whole words, the index just wraps
+    if (power_of_two)
+    {
+        return (row[w] << 1) | (row[(w - 1) & (words - 1)] >> 63);
+    }
+
+    uint64_t carry = (w > 0) ? row[w - 1] >> 63
+                             : (row[words - 1] >> ((board_columns - 1) % 64)) & 1;
+    return (row[w] << 1) | carry;
+}
+
+// function to get a word of a bit row shifted so that bit b holds the cell
+// east (right) of the cell of bit b, wrapping around the board
+static inline uint64_t east_word(const uint64_t *row, int w, int words, int power_of_two)
+{
+    if (power_of_two)
+    {
+        return (row[w] >> 1) | (row[(w + 1) & (words - 1)] << 63);
+    }
+
+    if (w < words - 1)
+    {
+        return (row[w] >> 1) | (row[w + 1] << 63);
+    }
+    return (row[w] >> 1) | ((row[0] & 1) << ((board_columns - 1) % 64));
+}
+
+// function to add three one-bit numbers on 64 lanes at once
+void full_adder(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum, uint64_t *carry)
+{
+    uint64_t partial = a ^ b;
+    *sum = partial ^ c;
+    *carry = (a & b) | (partial & c);
+}
+
+// function to compute row i of the next generation of the bit plane, 64 cells
+// per word. The 8 neighbor bits are added with bit-sliced full adders into a
+// 3-bit count (modulo 8, which is enough to tell 2 and 3 apart from the rest);
+// the color plane is only touched for the cells that are born.
+// power_of_two is a constant at both calls, which builds one copy of the
+// kernel for power of two boards, wrapping every index with a mask, and one
+// that compares against the edges and masks the partial last word.
+static inline __attribute__((always_inline)) void update_bit_row(BitPlane plane, BitPlane next, Board colors, int i, Population *population, int power_of_two)
+{
+    int words = plane.words;
+    int up_row = power_of_two ? (i - 1) & (board_rows - 1) : (i == 0) ? board_rows - 1 : i - 1;
+    int down_row = power_of_two ? (i + 1) & (board_rows - 1) : (i == board_rows - 1) ? 0 : i + 1;
+
+    const uint64_t *up = plane.alive + (size_t)up_row * words;
+    const uint64_t *middle = plane.alive + (size_t)i * words;
+    const uint64_t *down = plane.alive + (size_t)down_row * words;
+
+    for (int w = 0; w < words; w++)
+    {
+        // bits past the right edge of the board stay dead
+        uint64_t valid = (!power_of_two && w == words - 1 && board_columns % 64) ? ((uint64_t)1 << (board_columns % 64)) - 1 : ~(uint64_t)0;
+
+        uint64_t upper_sum, upper_carry, lower_sum, lower_carry;
+        full_adder(west_word(up, w, words, power_of_two), up[w], east_word(up, w, words, power_of_two), &upper_sum, &upper_carry);
+        full_adder(west_word(down, w, words, power_of_two), down[w], east_word(down, w, words, power_of_two), &lower_sum, &lower_carry);
+
+        uint64_t west = west_word(middle, w, words, power_of_two);
+        uint64_t east = east_word(middle, w, words, power_of_two);
+        uint64_t side_sum = west ^ east;
+        uint64_t side_carry = west & east;
+
+        // ones of the count, plus one more carry into the twos
+        uint64_t bit0, ones_carry;
+        full_adder(upper_sum, lower_sum, side_sum, &bit0, &ones_carry);
+
+        // twos and fours of the count (the eights are dropped)
+        uint64_t twos, twos_carry;
+        full_adder(upper_carry, lower_carry, side_carry, &twos, &twos_carry);
+        uint64_t bit1 = twos ^ ones_carry;
+        uint64_t bit2 = twos_carry ^ (twos & ones_carry);
+
+        uint64_t alive = middle[w];
+        uint64_t two_or_three = bit1 & ~bit2;
+        uint64_t born = ~alive & two_or_three & bit0 & valid;
+        uint64_t survives = alive & two_or_three;
+
+        next.alive[(size_t)i * words + w] = survives | born;
+        next.born[(size_t)i * words + w] = born;
+
+        population->live += __builtin_popcountll(alive);
+        population->births += __builtin_popcountll(born);
+        population->deaths += __builtin_popcountll(alive & ~survives);
+
+        // color of every born cell: average of the 3x3 block, summed in the
+        // same order as the float kernel so both engines give the same colors
+        while (born)
         {
-            
-            for(int k = 0; k < board_size; k++)
-            {
-                
-                // get neighbors
-                int number_of_neighbors = get_neighbors(grid, j, k);
+            int j = w * 64 + __builtin_ctzll(born);
+            int left = power_of_two ? (j - 1) & (board_columns - 1) : (j == 0) ? board_columns - 1 : j - 1;
+            int right = power_of_two ? (j + 1) & (board_columns - 1) : (j == board_columns - 1) ? 0 : j + 1;
+
+            float left_sum = bit_cell_color(plane, colors, up_row, left) + bit_cell_color(plane, colors, i, left) + bit_cell_color(plane, colors, down_row, left);
+            float center_sum = bit_cell_color(plane, colors, up_row, j) + bit_cell_color(plane, colors, i, j) + bit_cell_color(plane, colors, down_row, j);
+            float right_sum = bit_cell_color(plane, colors, up_row, right) + bit_cell_color(plane, colors, i, right) + bit_cell_color(plane, colors, down_row, right);
+
+            // a cell born now is dead in this generation, so no color of
+            // this generation is overwritten
+            CELL(colors, i, j) = (left_sum + center_sum + right_sum) / (float)8.0;
+
+            born &= born - 1;
+        }
+    }
+}
 
+// function to write the float board described by a bit plane and the color plane
+void bit_plane_to_board(BitPlane plane, Board colors, Board grid)
+{
+    #pragma omp parallel for
+    for (int i = 0; i < board_rows; i++)
+    {
+        for (int j = 0; j < board_columns; j++)
+        {
+            CELL(grid, i, j) = bit_cell_color(plane, colors, i, j);
+        }
+    }
+}
+
+// function to execute iterations with the bit-packed engine: the occupancy
+// lives in bit planes and grid is only used as the color plane of the cells
+// born in the last generation. The final board is written back into grid.
+void execute_iterations_bits(Board grid, Board newgrid, int iterations)
+{
+    BitPlane plane = allocate_bit_plane();
+    BitPlane next = allocate_bit_plane();
 
-                if(grid[j][k] > 0.0)
+    // the initial live cells keep the colors they were given
+    #pragma omp parallel for
+    for (int i = 0; i < board_rows; i++)
+    {
+        for (int w = 0; w < plane.words; w++)
+        {
+            uint64_t word = 0;
+            for (int b = 0; b < 64 && w * 64 + b < board_columns; b++)
+            {
+                if (CELL(grid, i, w * 64 + b) > 0.0)
                 {
-                    if(number_of_neighbors == 2 || number_of_neighbors == 3)
-                    {
-                        newgrid[j][k] = 1;
-                    }
-                    else
-                    {
-                        newgrid[j][k] = 0.0;
-                    }
+                    word |= (uint64_t)1 << b;
                 }
-                else
-                {
-                    if(number_of_neighbors == 3)
-                    {   // calculate average of neighbors
-                        newgrid[j][k] = average_neighbors_value(grid, j, k);
-                    }
-                    else
-                    {
-                        newgrid[j][k] = 0.0;
-                    }
-                }   
             }
+            plane.alive[(size_t)i * plane.words + w] = word;
+            plane.born[(size_t)i * plane.words + w] = word;
         }
-        
-        // print iteration
-        printf("iteration: %d ", i);
+    }
 
-        // compute live cells
-        compute_live_cells(grid);
+    Population population = {0, 0, 0};
 
-        // swap grids
-        float** temp = grid;
-        grid = newgrid;
-        newgrid = temp;
+    // boards with power of two sides (at least 64 columns, so whole words)
+    // take the kernel that wraps with masks
+    int power_of_two = is_power_of_two(board_rows) && is_power_of_two(board_columns);
+
+    for (int i = 0; i < iterations; i++)
+    {
+        int live = 0, births = 0, deaths = 0;
+        #pragma omp parallel for reduction(+:live, births, deaths)
+        for (int j = 0; j < board_rows; j++)
+        {
+            Population row = {0, 0, 0};
+            if (power_of_two)
+            {
+                update_bit_row(plane, next, grid, j, &row, 1);
+            }
+            else
+            {
+                update_bit_row(plane, next, grid, j, &row, 0);
+            }
+            live += row.live;
+            births += row.births;
+            deaths += row.deaths;
+        }
+        population.live = live;
+        population.births = births;
+        population.deaths = deaths;
+
+        // print iteration
+        if(report_interval > 0 && i % report_interval == 0)
+        {
+            report_population(i, population);
+        }
+
+        // swap planes
+        BitPlane temp = plane;
+        plane = next;
+        next = temp;
 
         if(i < 5)
         {
-            show_50_50_grid(grid);
+            bit_plane_to_board(plane, grid, newgrid);
+            show_50_50_grid(newgrid);
         }
     }
-    compute_live_cells(grid);
+    // write the final generation back as a float board (each cell only
+    // reads its own color, so it can be done in place)
+    bit_plane_to_board(plane, grid, grid);
+
+    // population of the last generation
+    if(iterations > 0)
+    {
+        printf("live cells: %d\n", population.live + population.births - population.deaths);
+    }
+    else
+    {
+        compute_live_cells(grid);
+    }
+
+    free_bit_plane(plane);
+    free_bit_plane(next);
 }
 
 // function to compute live cells
-void compute_live_cells(float **grid)
+void compute_live_cells(Board grid)
 {
     int live_cells = 0;
     #pragma omp parallel for reduction(+:live_cells)
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 live_cells++;
             }
@@ -294,54 +1216,83 @@ void compute_live_cells(float **grid)
     return;  
 }
 
+// function to tell whether n is a power of two
+int is_power_of_two(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// function to read the board size from "rows" (a square board) or
+// "rowsxcolumns"; the initial patterns and the 50x50 corner printed for the
+// first generations need at least 50x50 cells
+void parse_board_size(const char *text)
+{
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if (fields == 1)
+    {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if (fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50)
+    {
+        printf("invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        exit(1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
 // function to show 50x50 grid
-void show_50_50_grid(float **grid)
+void show_50_50_grid(Board grid)
 {
     for (int i = 0; i < 50; i++)
     {
         for (int j = 0; j < 50; j++)
         {
-            if (grid[i][j] == 0.0)
+            if (CELL(grid, i, j) == 0.0)
             {
                 printf(". ");
             }
-            else if (grid[i][j] <= 0.0833)
+            else if (CELL(grid, i, j) <= 0.0833)
             {
                 printf(", ");
             }
-            else if (grid[i][j] <= 0.1666)
+            else if (CELL(grid, i, j) <= 0.1666)
             {
                 printf("- ");
             }
-            else if (grid[i][j] <= 0.25)
+            else if (CELL(grid, i, j) <= 0.25)
             {
                 printf("~ ");
             }
-            else if (grid[i][j] <= 0.3333)
+            else if (CELL(grid, i, j) <= 0.3333)
             {
                 printf(": ");
             }
-            else if (grid[i][j] <= 0.4166)
+            else if (CELL(grid, i, j) <= 0.4166)
             {
                 printf("; ");
             }
-            else if (grid[i][j] <= 0.5)
+            else if (CELL(grid, i, j) <= 0.5)
             {
                 printf("= ");
             }
-            else if (grid[i][j] <= 0.5833)
+            else if (CELL(grid, i, j) <= 0.5833)
             {
                 printf("! ");
             }
-            else if (grid[i][j] <= 0.6666)
+            else if (CELL(grid, i, j) <= 0.6666)
             {
                 printf("* ");
             }
-            else if (grid[i][j] <= 0.75)
+            else if (CELL(grid, i, j) <= 0.75)
             {
                 printf("# ");
             }
-            else if (grid[i][j] <= 0.8333)
+            else if (CELL(grid, i, j) <= 0.8333)
             {
                 printf("$ ");
             }
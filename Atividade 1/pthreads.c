@@ -11,48 +11,194 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 
+#ifdef __linux__
+// futex system call used by the barrier to sleep after spinning
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+// SIMD intrinsics for the vectorized kernels
+#include <immintrin.h>
+#endif
+
 int NUM_THREADS;
-#define board_size 2048
-#define number_of_iterations 2000
 
+// size of the board and number of generations, set with -n and -i
+int board_rows = 2048;
+int board_columns = 2048;
+int number_of_iterations = 2000;
+
+// alignment (in bytes) of the board slab and of every row inside it
+#define board_alignment 64
+
+// columns reserved in front of every row: column 0 stays cache line aligned
+// and column -1 (the last padding float) is the left ghost column
+#define board_padding (board_alignment / (int)sizeof(float))
+
+// board stored as one contiguous slab, row i starts at cells + i * stride,
+// surrounded by a ghost ring that mirrors the opposite edges of the board
+typedef struct {
+    float *slab;
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board, -1 <= i <= board_rows and -1 <= j <= board_columns
+#define CELL(board, i, j) ((board).cells[(ptrdiff_t)(i) * (board).stride + (j)])
+
+// population of the generation read by the kernels and how it changes into
+// the generation they write, counted while the new generation is computed
 typedef struct {
+    int live;
+    int births;
+    int deaths;
+} Population;
+
+// print the population every report_interval generations (0: only at the end)
+int report_interval = 1;
+
+// side of the square tiles used to skip the quiet parts of the board
+#define tile_size 64
+
+// Active tiles: the board is split in tile_size x tile_size tiles and a tile
+// is only computed when it or one of its 8 neighbors changed in the previous
+// generation. Any other tile is known to stay exactly the same, and the copy
+// of it in the other grid (two generations old) is already the right one.
+typedef struct {
+    int rows;
+    int columns;
+    unsigned char *changed;
+    int *active;
+    int active_count;
+} Tiles;
+
+// compute only the active tiles instead of the whole board
+int sparse_tiles = 0;
+
+// next entry of the active tile list to be taken by a thread
+atomic_int next_active_tile;
+
+// row kernel used for every generation, chosen at startup by select_row_kernel();
+// it computes columns [first, last) of row i of the next generation
+void (*update_row)(Board grid, Board newgrid, int i, int first, int last, Population *population);
+
+// number of spins on the barrier before a thread goes to sleep
+#define barrier_spin_limit 2000
+
+// Sense-reversing barrier: the last thread to arrive resets the counter and
+// flips the shared sense, which releases everybody waiting for it. Waiting
+// threads spin for a while and then sleep on a futex (yield elsewhere).
+typedef struct {
+    atomic_int remaining;
+    atomic_int sense;
+    atomic_int sleepers;
+    int parties;
+    int spin_limit;
+} Barrier;
+
+// barrier shared by the worker pool
+Barrier pool_barrier;
+
+typedef struct ThreadData {
+    int id;
     int start_row;
     int end_row;
-    float** grid;
-    float** newgrid;
+    int iterations;
+    Board grid;
+    Board newgrid;
+    // counts of the thread's rows, one slot per generation parity so the
+    // next generation never overwrites the slot thread 0 is still reading
+    Population population[2];
+    // population of the whole board, kept by thread 0 when tiles are skipped
+    Population total;
+    Tiles *tiles;
+    struct ThreadData *pool;
 } ThreadData;
 
-float** allocate_board();
-void free_board(float **grid);
-void initialize_board(float **grid);
-void execute_iterations(float **grid, float **newgrid, int iterations);
-void compute_live_cells(float **grid);
-int get_neighbors(float **grid, int i, int j);
+Board allocate_board();
+void free_board(Board grid);
+void initialize_board(Board grid);
+void update_ghost_cells(Board grid);
+void update_ghost_rows(Board grid, int start_row, int end_row);
+void barrier_init(Barrier *barrier, int parties);
+void barrier_wait(Barrier *barrier, int *local_sense);
+void execute_iterations(Board grid, Board newgrid, int iterations);
+void compute_live_cells(Board grid);
+void update_cells(Board grid, Board newgrid, int i, int first, int last, Population *population);
+void report_population(int i, Population population);
+Population pool_population(ThreadData *pool, int parity);
+Tiles allocate_tiles();
+void free_tiles(Tiles tiles);
+void update_tile(Board grid, Board newgrid, Tiles tiles, int t, Population *population);
+void select_active_tiles(Tiles *tiles);
+void select_row_kernel(const char *requested);
 void* thread_work(void* args);
-float average_neighbors_value(float **grid, int i, int j);
-void show_50_50_grid(float **grid);
+void show_50_50_grid(Board grid);
+void parse_board_size(const char *text);
 
 int main(int argc, char **argv)
 {   
     struct timeval start, finish, begin, end;
     gettimeofday(&start, NULL); // start time of the program
 
-    if(argc != 2)
+    const char *kernel = NULL; // row kernel, NULL picks the widest one available
+    int option;
+    while ((option = getopt(argc, argv, "k:r:sn:i:")) != -1)
+    {
+        if (option == 'k')
+        {
+            kernel = optarg;
+        }
+        else if (option == 'r' && atoi(optarg) >= 0)
+        {
+            report_interval = atoi(optarg);
+        }
+        else if (option == 's')
+        {
+            sparse_tiles = 1;
+        }
+        else if (option == 'n')
+        {
+            parse_board_size(optarg);
+        }
+        else if (option == 'i' && atoi(optarg) >= 0)
+        {
+            number_of_iterations = atoi(optarg);
+        }
+        else
+        {
+            break; // an unknown option or a missing argument
+        }
+    }
+
+    if(option != -1 || optind != argc - 1)
     {
-        printf("Usage: %s <number of threads>\n", argv[0]);
+        printf("Usage: %s [-k scalar|avx2|avx512] [-r report interval] [-s] [-n rows[xcolumns]] [-i iterations] <number of threads>\n", argv[0]);
         exit(1);
     }
 
     // The number of threads is passed as an argument to the program
-    NUM_THREADS = atoi(argv[1]);
+    NUM_THREADS = atoi(argv[optind]);
+    if(NUM_THREADS < 1 || NUM_THREADS > board_rows)
+    {
+        printf("The number of threads must be between 1 and %d\n", board_rows);
+        exit(1);
+    }
 
-    float **grid, **newgrid;
+    select_row_kernel(kernel);
+
+    Board grid, newgrid;
 
     // allocate memory for the board
     grid = allocate_board();
@@ -84,231 +230,659 @@ int main(int argc, char **argv)
     return 0;
 }
 
-// function to execute the work of each thread
+// function to execute the work of each thread: the thread lives for the
+// whole run and advances its rows one generation at a time, meeting the
+// other threads at the barrier instead of being created and joined again
 void* thread_work(void* args) 
 {
     ThreadData* data = (ThreadData*)args; // get the thread data
-    for (int j = data->start_row; j < data->end_row; j++) // iterate over the rows
+    Board grid = data->grid;
+    Board newgrid = data->newgrid;
+    int local_sense = 0;
+
+    for (int i = 0; i < data->iterations; i++)
     {
-        for (int k = 0; k < board_size; k++)  // iterate over the columns
+        if (sparse_tiles)
         {
-            int number_of_neighbors = get_neighbors(data->grid, j, k);
-            if(data->grid[j][k] > 0.0)  // if the cell is alive
+            // the active tiles are taken one at a time from the shared list,
+            // the quiet parts of the board are not split evenly among threads
+            Population population = {0, 0, 0};
+            int a;
+            while ((a = atomic_fetch_add(&next_active_tile, 1)) < data->tiles->active_count)
             {
-                if(number_of_neighbors == 2 || number_of_neighbors == 3)  // if the cell has 2 or 3 neighbors, it survives
-                {
-                    data->newgrid[j][k] = 1;
-                } 
-                else  // if the cell has less than 2 or more than 3 neighbors, it dies
+                update_tile(grid, newgrid, *data->tiles, data->tiles->active[a], &population);
+            }
+            data->population[i % 2] = population;
+
+            // the ring can only be refreshed once every tile is done
+            barrier_wait(&pool_barrier, &local_sense);
+            update_ghost_rows(newgrid, data->start_row, data->end_row);
+
+            if (data->id == 0)
+            {
+                select_active_tiles(data->tiles);
+                atomic_store(&next_active_tile, 0);
+
+                // the skipped tiles keep their live cells: after the first
+                // generation (all tiles active) the count is carried over
+                Population total = pool_population(data->pool, i % 2);
+                if (i > 0)
                 {
-                    data->newgrid[j][k] = 0.0;
+                    total.live = data->total.live + data->total.births - data->total.deaths;
                 }
-            } 
-            else // if the cell is dead
-            {
-                if(number_of_neighbors == 3)  // if the cell has 3 neighbors, it becomes alive
+                data->total = total;
+
+                if(report_interval > 0 && i % report_interval == 0)
                 {
-                    data->newgrid[j][k] = average_neighbors_value(data->grid, j, k);
-                } 
-                else // if the cell has less than 3 or more than 3 neighbors, it stays dead
+                    report_population(i, total);
+                }
+                if(i < 5)
                 {
-                    data->newgrid[j][k] = 0.0;
+                    show_50_50_grid(newgrid);
                 }
             }
+
+            // nobody starts on the next generation before its tiles are listed
+            barrier_wait(&pool_barrier, &local_sense);
+
+            Board temp = grid;
+            grid = newgrid;
+            newgrid = temp;
+            continue;
+        }
+
+        // the kernels count the population of our rows as they go
+        Population population = {0, 0, 0};
+        for (int j = data->start_row; j < data->end_row; j++) // iterate over the rows
+        {
+            update_row(grid, newgrid, j, 0, board_columns, &population);
         }
+        data->population[i % 2] = population;
+
+        // prepare the ghost ring of the next generation for our own rows
+        update_ghost_rows(newgrid, data->start_row, data->end_row);
+
+        // wait until the whole new generation is computed; nobody reads the
+        // old one anymore, so it can be overwritten right after this
+        barrier_wait(&pool_barrier, &local_sense);
+
+        if (data->id == 0)
+        {
+            if(report_interval > 0 && i % report_interval == 0)
+            {
+                report_population(i, pool_population(data->pool, i % 2));
+            }
+            if(i < 5)
+            {
+                show_50_50_grid(newgrid);
+            }
+        }
+
+        // every thread swaps its own copy of the grids
+        Board temp = grid;
+        grid = newgrid;
+        newgrid = temp;
     }
     return NULL;
 }
 
+// function to initialize a barrier for a number of threads
+void barrier_init(Barrier *barrier, int parties)
+{
+    atomic_init(&barrier->remaining, parties);
+    atomic_init(&barrier->sense, 0);
+    atomic_init(&barrier->sleepers, 0);
+    barrier->parties = parties;
+
+    // spinning only pays off when every thread has a CPU of its own
+    barrier->spin_limit = (parties <= sysconf(_SC_NPROCESSORS_ONLN)) ? barrier_spin_limit : 0;
+}
+
+// function to wait at the barrier, local_sense is private to each thread
+void barrier_wait(Barrier *barrier, int *local_sense)
+{
+    int sense = !*local_sense;
+    *local_sense = sense;
+
+    if (atomic_fetch_sub(&barrier->remaining, 1) == 1)
+    {
+        // last thread to arrive: rearm the barrier and release the others
+        atomic_store(&barrier->remaining, barrier->parties);
+        atomic_store(&barrier->sense, sense);
+#ifdef __linux__
+        if (atomic_load(&barrier->sleepers) > 0)
+        {
+            syscall(SYS_futex, (int *)&barrier->sense, FUTEX_WAKE_PRIVATE, barrier->parties, NULL, NULL, 0);
+        }
+#endif
+        return;
+    }
+
+    for (int spin = 0; atomic_load(&barrier->sense) != sense; spin++)
+    {
+        if (spin < barrier->spin_limit)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+            continue;
+        }
+#ifdef __linux__
+        // sleep while the sense is still the old one
+        atomic_fetch_add(&barrier->sleepers, 1);
+        syscall(SYS_futex, (int *)&barrier->sense, FUTEX_WAIT_PRIVATE, !sense, NULL, NULL, 0);
+        atomic_fetch_sub(&barrier->sleepers, 1);
+#else
+        sched_yield();
+#endif
+    }
+}
+
 
 // function to allocate board
-float** allocate_board()
+Board allocate_board()
 {
-    float ** grid;
-    // allocate memory for the board
-    grid = (float **)malloc(board_size * sizeof(float *));
-    for (int i = 0; i < board_size; i++)
+    Board grid;
+    int floats_per_line = board_alignment / sizeof(float);
+
+    // padding + row + right ghost column, rounded up to whole cache lines
+    grid.stride = (board_padding + board_columns + 1 + floats_per_line - 1) / floats_per_line * floats_per_line;
+
+    // one aligned allocation for the whole board plus the two ghost rows
+    grid.slab = (float *)aligned_alloc(board_alignment, (size_t)(board_rows + 2) * grid.stride * sizeof(float));
+    if (grid.slab == NULL)
     {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+        printf("could not allocate the board\n");
+        exit(1);
     }
+    grid.cells = grid.slab + grid.stride + board_padding;
 
     return grid;
 }
 
 // function to free board
-void free_board(float **grid)
+void free_board(Board grid)
 {
     // free memory for the board
-    for (int i = 0; i < board_size; i++)
-    {
-        free(grid[i]);
-    }
-    free(grid);
+    free(grid.slab);
 }
 
 // function to initialize board
-void initialize_board(float **grid)
+void initialize_board(Board grid)
 {   
     printf("initializing board...\n");
     // clear the board
-    for(int i = 0; i < board_size; i++)
+    for(int i = 0; i < board_rows; i++)
     {
-        for(int j = 0; j < board_size; j++)
+        for(int j = 0; j < board_columns; j++)
         {
-            grid[i][j] = 0.0;
+            CELL(grid, i, j) = 0.0;
         }
     }
     printf("board cleared\n");
 
     // initialize the board from position (1,1) with glider pattern
     // and a R-pentomino pattern in (10, 30)
-    grid[1][2] = 1.0;
-    grid[2][3] = 1.0;
-    grid[3][1] = 1.0;
-    grid[3][2] = 1.0;
-    grid[3][3] = 1.0;
-
-    grid[10][31] = 1.0;
-    grid[10][32] = 1.0;
-    grid[11][30] = 1.0;
-    grid[11][31] = 1.0;
-    grid[12][31] = 1.0;
+    CELL(grid, 1, 2) = 1.0;
+    CELL(grid, 2, 3) = 1.0;
+    CELL(grid, 3, 1) = 1.0;
+    CELL(grid, 3, 2) = 1.0;
+    CELL(grid, 3, 3) = 1.0;
+
+    CELL(grid, 10, 31) = 1.0;
+    CELL(grid, 10, 32) = 1.0;
+    CELL(grid, 11, 30) = 1.0;
+    CELL(grid, 11, 31) = 1.0;
+    CELL(grid, 12, 31) = 1.0;
 
 }
 
-// function to get the number of neighbors of a cell
-int get_neighbors(float **grid, int i, int j)
+// function to copy the opposite edges of the board into the ghost ring
+void update_ghost_cells(Board grid)
 {
-    int number_of_neighbors = 0;
+    update_ghost_rows(grid, 0, board_rows);
+}
 
-    // check the 8 neighbors of the cell
-    for(int k = i - 1; k <= i + 1; k++)
+// function to refresh the ghost cells that mirror rows [start_row, end_row),
+// so each thread can prepare the ring for the rows it owns
+void update_ghost_rows(Board grid, int start_row, int end_row)
+{
+    // left and right ghost columns
+    for (int i = start_row; i < end_row; i++)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
+        CELL(grid, i, -1) = CELL(grid, i, board_columns - 1);
+        CELL(grid, i, board_columns) = CELL(grid, i, 0);
+    }
 
-            int k_aux = k;
-            int l_aux = l;
+    // upper and lower ghost rows, corners included
+    if (end_row == board_rows)
+    {
+        memcpy(&CELL(grid, -1, -1), &CELL(grid, board_rows - 1, -1), (board_columns + 2) * sizeof(float));
+    }
+    if (start_row == 0)
+    {
+        memcpy(&CELL(grid, board_rows, -1), &CELL(grid, 0, -1), (board_columns + 2) * sizeof(float));
+    }
+}
 
-            if(k == i && l == j) // skip the cell itself
-            {
-                continue;
-            }
+// function to compute columns [first, last) of row i of the next generation
+// in a single pass. The 3x3 window is kept as three vertical sums (live count
+// and color sum of columns j - 1, j and j + 1); moving one cell to the right
+// reuses two of them, so each cell loads only the three floats of column j + 1.
+// The population counts of the range are added to population.
+void update_cells(Board grid, Board newgrid, int i, int first, int last, Population *population)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    // vertical sums of columns first - 1 and first (the ghost ring makes -1 valid)
+    int left_count = (up[first - 1] > 0.0) + (middle[first - 1] > 0.0) + (down[first - 1] > 0.0);
+    float left_sum = up[first - 1] + middle[first - 1] + down[first - 1];
+    int center_count = (up[first] > 0.0) + (middle[first] > 0.0) + (down[first] > 0.0);
+    float center_sum = up[first] + middle[first] + down[first];
+
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < last; j++)
+    {
+        // vertical sums of the column entering the window
+        int right_count = (up[j + 1] > 0.0) + (middle[j + 1] > 0.0) + (down[j + 1] > 0.0);
+        float right_sum = up[j + 1] + middle[j + 1] + down[j + 1];
 
-            if(k == -1) // if the cell is in the border, get the value from the other side
-            {
-                k_aux = board_size - 1;
-            }
-            else if (k == board_size) // if the cell is in the border, get the value from the other side
-            {
-                k_aux = 0;
-            }
-            
-            if(l == -1) // if the cell is in the border, get the value from the other side
-            {
-                l_aux = board_size - 1;
-            }
-            else if(l == board_size) // if the cell is in the border, get the value from the other side
-            {
-                l_aux = 0;
-            }
+        int alive = middle[j] > 0.0;
+        int number_of_neighbors = left_count + center_count + right_count - alive;
 
-            if(grid[k_aux][l_aux] > 0.0) // if the neighbor is alive
-            {   
-                number_of_neighbors++;
-            }
+        if (alive)
+        {
+            // survives with 2 or 3 neighbors
+            int survives = number_of_neighbors == 2 || number_of_neighbors == 3;
+            next[j] = survives ? 1.0 : 0.0;
+            deaths += !survives;
+        }
+        else
+        {
+            // born with 3 neighbors, colored by the average of the 3x3 block
+            int born = number_of_neighbors == 3;
+            next[j] = born ? (left_sum + center_sum + right_sum) / (float)8.0 : 0.0;
+            births += born;
         }
+        live += alive;
+
+        // slide the window one column to the right
+        left_count = center_count;
+        left_sum = center_sum;
+        center_count = right_count;
+        center_sum = right_sum;
     }
- 
-    // printf("number of neighbors: %d\n", number_of_neighbors);
-    return number_of_neighbors;
+
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
 }
 
-// function to get the average value of the neighbors of a cell
-float average_neighbors_value(float** grid, int i,  int j)
+#if defined(__x86_64__) || defined(__i386__)
+// function to compute columns [first, last) of row i of the next generation
+// 8 cells at a time with AVX2.
+// Each lane holds one cell: the alive masks come from compares against 0.0,
+// the neighbor counts from adding the masked 1.0s of the 3x3 window, and the
+// survive/birth/die outcome is selected with blends, the birth color being
+// computed in the same lanes.
+__attribute__((target("avx2")))
+void update_row_avx2(Board grid, Board newgrid, int i, int first, int last, Population *population)
 {
-    float average = 0.0; // average value of the neighbors
-    
-    // check the 8 neighbors of the cell
-    for(int k = i - 1; k <= i + 1; k++)
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 eighth = _mm256_set1_ps(0.125f);
+
+    int vector_end = last - (last - first) % 8;
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < vector_end; j += 8)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
+        // vertical color sums and live counts of columns j - 1, j and j + 1
+        __m256 sum[3];
+        __m256 count[3];
+        for (int c = 0; c < 3; c++)
+        {
+            __m256 u = _mm256_loadu_ps(up + j + c - 1);
+            __m256 m = _mm256_loadu_ps(middle + j + c - 1);
+            __m256 d = _mm256_loadu_ps(down + j + c - 1);
+
+            sum[c] = _mm256_add_ps(_mm256_add_ps(u, m), d);
+            count[c] = _mm256_add_ps(_mm256_add_ps(_mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ), one),
+                                                   _mm256_and_ps(_mm256_cmp_ps(m, zero, _CMP_GT_OQ), one)),
+                                     _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), one));
+        }
 
-            int k_aux = k;
-            int l_aux = l;
+        __m256 cell = _mm256_loadu_ps(middle + j);
+        __m256 alive = _mm256_cmp_ps(cell, zero, _CMP_GT_OQ);
+
+        // the window count includes the cell itself
+        __m256 neighbors = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(count[0], count[1]), count[2]),
+                                         _mm256_and_ps(alive, one));
+        __m256 has_two = _mm256_cmp_ps(neighbors, two, _CMP_EQ_OQ);
+        __m256 has_three = _mm256_cmp_ps(neighbors, three, _CMP_EQ_OQ);
+
+        __m256 survive = _mm256_and_ps(alive, _mm256_or_ps(has_two, has_three));
+        __m256 birth = _mm256_andnot_ps(alive, has_three);
+        __m256 average = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(sum[0], sum[1]), sum[2]), eighth);
+
+        // die -> 0.0, birth -> average, survive -> 1.0
+        __m256 result = _mm256_blendv_ps(zero, average, birth);
+        result = _mm256_blendv_ps(result, one, survive);
+        _mm256_storeu_ps(next + j, result);
+
+        // population counts from the lane masks
+        int alive_lanes = _mm256_movemask_ps(alive);
+        live += __builtin_popcount(alive_lanes);
+        births += __builtin_popcount(_mm256_movemask_ps(birth));
+        deaths += __builtin_popcount(alive_lanes & ~_mm256_movemask_ps(survive));
+    }
 
-            if(k == -1) // if k is -1, then k_aux is the last position of the board
-            {
-                k_aux = board_size - 1;
-            }
-            else if (k == board_size) // if k is board_size, then k_aux is the first position of the board
-            { 
-                k_aux = 0;
-            }
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
+
+    // cells left over when the range is not a multiple of the vector width
+    // the scalar kernel is plain SSE code: clear the upper halves of the
+    // vector registers first or every one of its instructions pays for them
+    _mm256_zeroupper();
+    update_cells(grid, newgrid, i, vector_end, last, population);
+}
+
+// function to compute columns [first, last) of row i of the next generation
+// 16 cells at a time with AVX-512, same scheme as the AVX2 kernel but with
+// mask registers
+__attribute__((target("avx512f")))
+void update_row_avx512(Board grid, Board newgrid, int i, int first, int last, Population *population)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+    const __m512 eighth = _mm512_set1_ps(0.125f);
+
+    int vector_end = last - (last - first) % 16;
+    int live = 0;
+    int births = 0;
+    int deaths = 0;
+
+    for (int j = first; j < vector_end; j += 16)
+    {
+        __m512 sum[3];
+        __m512 count[3];
+        for (int c = 0; c < 3; c++)
+        {
+            __m512 u = _mm512_loadu_ps(up + j + c - 1);
+            __m512 m = _mm512_loadu_ps(middle + j + c - 1);
+            __m512 d = _mm512_loadu_ps(down + j + c - 1);
+
+            sum[c] = _mm512_add_ps(_mm512_add_ps(u, m), d);
+            count[c] = _mm512_add_ps(_mm512_add_ps(_mm512_maskz_mov_ps(_mm512_cmp_ps_mask(u, zero, _CMP_GT_OQ), one),
+                                                   _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(m, zero, _CMP_GT_OQ), one)),
+                                     _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ), one));
+        }
+
+        __m512 cell = _mm512_loadu_ps(middle + j);
+        __mmask16 alive = _mm512_cmp_ps_mask(cell, zero, _CMP_GT_OQ);
+
+        __m512 neighbors = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(count[0], count[1]), count[2]),
+                                         _mm512_maskz_mov_ps(alive, one));
+        __mmask16 has_two = _mm512_cmp_ps_mask(neighbors, two, _CMP_EQ_OQ);
+        __mmask16 has_three = _mm512_cmp_ps_mask(neighbors, three, _CMP_EQ_OQ);
+
+        __mmask16 survive = alive & (has_two | has_three);
+        __mmask16 birth = ~alive & has_three;
+        __m512 average = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(sum[0], sum[1]), sum[2]), eighth);
+
+        __m512 result = _mm512_maskz_mov_ps(birth, average);
+        result = _mm512_mask_blend_ps(survive, result, one);
+        _mm512_storeu_ps(next + j, result);
+
+        live += __builtin_popcount(alive);
+        births += __builtin_popcount(birth);
+        deaths += __builtin_popcount(alive & ~survive);
+    }
+
+    population->live += live;
+    population->births += births;
+    population->deaths += deaths;
+
+    // the scalar kernel is plain SSE code: clear the upper halves of the
+    // vector registers first or every one of its instructions pays for them
+    _mm256_zeroupper();
+    update_cells(grid, newgrid, i, vector_end, last, population);
+}
+#endif
+
+// function to pick the row kernel at startup: the widest one this CPU
+// supports, or the one requested on the command line
+void select_row_kernel(const char *requested)
+{
+    const char *name = "scalar";
+    int has_avx2 = 0;
+    int has_avx512 = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    // CPUID based feature detection
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2");
+    has_avx512 = __builtin_cpu_supports("avx512f");
+#endif
+
+    if (requested == NULL)
+    {
+        requested = has_avx512 ? "avx512" : has_avx2 ? "avx2" : "scalar";
+    }
+
+    update_row = update_cells;
+#if defined(__x86_64__) || defined(__i386__)
+    if (strcmp(requested, "avx512") == 0 && has_avx512)
+    {
+        name = "avx512";
+        update_row = update_row_avx512;
+    }
+    else if (strcmp(requested, "avx2") == 0 && has_avx2)
+    {
+        name = "avx2";
+        update_row = update_row_avx2;
+    }
+#endif
+
+    if (strcmp(requested, name) != 0)
+    {
+        printf("%s kernel not available on this CPU\n", requested);
+    }
+    printf("row kernel: %s\n", name);
+}
 
-            if(l == -1) // if l is -1, then l_aux is the last position of the board
+// function to print the population of generation i and its changes
+void report_population(int i, Population population)
+{
+    printf("iteration: %d live cells: %d births: %d deaths: %d\n", i, population.live, population.births, population.deaths);
+}
+
+// function to add up the population slots of all the threads
+Population pool_population(ThreadData *pool, int parity)
+{
+    Population total = {0, 0, 0};
+    for (int t = 0; t < NUM_THREADS; t++)
+    {
+        total.live += pool[t].population[parity].live;
+        total.births += pool[t].population[parity].births;
+        total.deaths += pool[t].population[parity].deaths;
+    }
+    return total;
+}
+
+// function to allocate the tiles of the board, all of them active at first
+Tiles allocate_tiles()
+{
+    Tiles tiles;
+
+    tiles.rows = (board_rows + tile_size - 1) / tile_size;
+    tiles.columns = (board_columns + tile_size - 1) / tile_size;
+    int count = tiles.rows * tiles.columns;
+
+    tiles.changed = (unsigned char *)malloc(count * sizeof(unsigned char));
+    tiles.active = (int *)malloc(count * sizeof(int));
+    if (tiles.changed == NULL || tiles.active == NULL)
+    {
+        printf("could not allocate the tiles\n");
+        exit(1);
+    }
+
+    memset(tiles.changed, 1, count * sizeof(unsigned char));
+    select_active_tiles(&tiles);
+
+    return tiles;
+}
+
+// function to free the tiles
+void free_tiles(Tiles tiles)
+{
+    free(tiles.changed);
+    free(tiles.active);
+}
+
+// function to compute the next generation of tile t, recording whether any
+// of its cells changed (compared while the rows are still in cache)
+void update_tile(Board grid, Board newgrid, Tiles tiles, int t, Population *population)
+{
+    int first_row = t / tiles.columns * tile_size;
+    int first_column = t % tiles.columns * tile_size;
+    int last_row = (first_row + tile_size < board_rows) ? first_row + tile_size : board_rows;
+    int last_column = (first_column + tile_size < board_columns) ? first_column + tile_size : board_columns;
+    int changed = 0;
+
+    for (int i = first_row; i < last_row; i++)
+    {
+        update_row(grid, newgrid, i, first_column, last_column, population);
+        changed |= memcmp(&CELL(grid, i, first_column), &CELL(newgrid, i, first_column),
+                          (last_column - first_column) * sizeof(float)) != 0;
+    }
+
+    tiles.changed[t] = changed;
+}
+
+// function to list the tiles to compute in the next generation: the ones
+// with a changed tile around them (the board wraps around for tiles too)
+void select_active_tiles(Tiles *tiles)
+{
+    int rows = tiles->rows;
+    int columns = tiles->columns;
+
+    tiles->active_count = 0;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int active = 0;
+            for (int k = -1; k <= 1; k++)
             {
-                l_aux = board_size - 1;
+                for (int l = -1; l <= 1; l++)
+                {
+                    active |= tiles->changed[(row + k + rows) % rows * columns + (column + l + columns) % columns];
+                }
             }
-            else if(l == board_size) // if l is board_size, then l_aux is the first position of the board
+
+            if (active)
             {
-                l_aux = 0;
+                tiles->active[tiles->active_count++] = row * columns + column;
             }
-            
-            average += (float)grid[k_aux][l_aux]; 
         }
     }
 
-    return (float)average / (float)8.0; // return the average value of the neighbors
+    // the tiles left out do not change, the others set their flag again
+    memset(tiles->changed, 0, rows * columns * sizeof(unsigned char));
 }
 
 // function to execute iterations
-void execute_iterations(float **grid , float **newgrid, int iterations) 
+void execute_iterations(Board grid , Board newgrid, int iterations) 
 {
     pthread_t threads[NUM_THREADS];
     ThreadData thread_data[NUM_THREADS];
+    Tiles tiles;
 
-    for (int i = 0; i < iterations; i++) 
+    if (sparse_tiles)
     {
-        int rows_per_thread = board_size / NUM_THREADS;
-        for (int t = 0; t < NUM_THREADS; t++) 
-        {
-            thread_data[t].start_row = t * rows_per_thread;
-            thread_data[t].end_row = (t == NUM_THREADS - 1) ? board_size : (t + 1) * rows_per_thread;
-            thread_data[t].grid = grid;
-            thread_data[t].newgrid = newgrid;
+        tiles = allocate_tiles();
+        atomic_store(&next_active_tile, 0);
+    }
 
-            pthread_create(&threads[t], NULL, thread_work, &thread_data[t]); // create the threads
-        }
+    // the workers keep the ring up to date from here on
+    update_ghost_cells(grid);
+    barrier_init(&pool_barrier, NUM_THREADS);
 
-        // wait for all the threads to finish
-        for (int t = 0; t < NUM_THREADS; t++) 
-        {
-            pthread_join(threads[t], NULL); 
-        }
+    int rows_per_thread = board_rows / NUM_THREADS;
+    for (int t = 0; t < NUM_THREADS; t++) 
+    {
+        thread_data[t].id = t;
+        thread_data[t].start_row = t * rows_per_thread;
+        thread_data[t].end_row = (t == NUM_THREADS - 1) ? board_rows : (t + 1) * rows_per_thread;
+        thread_data[t].iterations = iterations;
+        thread_data[t].grid = grid;
+        thread_data[t].newgrid = newgrid;
+        thread_data[t].tiles = &tiles;
+        thread_data[t].pool = thread_data;
+    }
 
+    // the main thread works as thread 0, the others are created once
+    for (int t = 1; t < NUM_THREADS; t++) 
+    {
+        pthread_create(&threads[t], NULL, thread_work, &thread_data[t]); // create the threads
+    }
+    thread_work(&thread_data[0]);
+
+    // wait for all the threads to finish
+    for (int t = 1; t < NUM_THREADS; t++) 
+    {
+        pthread_join(threads[t], NULL); 
+    }
+
+    // population of the last generation
+    if(iterations > 0)
+    {
+        Population population = sparse_tiles ? thread_data[0].total : pool_population(thread_data, (iterations - 1) % 2);
+        printf("live cells: %d\n", population.live + population.births - population.deaths);
+    }
+    else
+    {
         compute_live_cells(grid);
-        float** temp = grid;
-        grid = newgrid;
-        newgrid = temp;
+    }
 
-        if(i < 5)
-        {
-            show_50_50_grid(grid);
-        }
+    if (sparse_tiles)
+    {
+        free_tiles(tiles);
     }
-    compute_live_cells(grid);
 }
 
-void compute_live_cells(float **grid)
+void compute_live_cells(Board grid)
 {
     int live_cells = 0;
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 live_cells++;
             }
@@ -318,13 +892,36 @@ void compute_live_cells(float **grid)
     return;  
 }
 
-void show_50_50_grid(float **grid)
+// function to read the board size from "rows" (a square board) or
+// "rowsxcolumns"; the initial patterns and the 50x50 corner printed for the
+// first generations need at least 50x50 cells
+void parse_board_size(const char *text)
+{
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if (fields == 1)
+    {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if (fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50)
+    {
+        printf("invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        exit(1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
+void show_50_50_grid(Board grid)
 {
     for(int i = 0; i < 50; i++)
     {
         for(int j = 0; j < 50; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 printf("@ ");
             }
@@ -11,24 +11,52 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
 #include <sys/time.h>
 
 
-// Constants of the program
-#define board_size 2048
-#define number_of_iterations 2000
-
-float** allocate_board();
-void free_board(float **grid);
-void initialize_board(float **grid);
-void execute_iterations(float **grid, float **newgrid, int iterations);
-void compute_live_cells(float **grid);
-int get_neighbors(float **grid, int i, int j);
-float average_neighbors_value(float **grid, int i, int j);
-void show_50_50_grid(float **grid);
+// Size of the board and number of generations, read from the command line
+// (-n rows or -n rowsxcolumns, -i iterations); the defaults are the original
+// 2048x2048 board and 2000 generations
+int board_rows = 2048;
+int board_columns = 2048;
+int number_of_iterations = 2000;
+
+// alignment (in bytes) of the board slab and of every row inside it
+#define board_alignment 64
+
+// columns reserved in front of every row: column 0 stays cache line aligned
+// and column -1 (the last padding float) is the left ghost column
+#define board_padding (board_alignment / (int)sizeof(float))
+
+// The board is a single contiguous slab: row i starts at cells + i * stride.
+// The stride is the row length rounded up to a full cache line, so every row
+// starts aligned and the whole board can be streamed by the prefetcher.
+// Around the board there is a one-cell ghost ring (rows -1 and board_rows,
+// columns -1 and board_columns) holding a copy of the opposite edges, so the
+// neighbors of any cell can be read without wrapping the indexes.
+typedef struct {
+    float *slab;
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board, -1 <= i <= board_rows and -1 <= j <= board_columns
+#define CELL(board, i, j) ((board).cells[(ptrdiff_t)(i) * (board).stride + (j)])
+
+Board allocate_board();
+void free_board(Board grid);
+void initialize_board(Board grid);
+void update_ghost_cells(Board grid);
+void execute_iterations(Board grid, Board newgrid, int iterations);
+void compute_live_cells(Board grid);
+void update_row(Board grid, Board newgrid, int i);
+void show_50_50_grid(Board grid);
+void parse_board_size(const char *text);
 
 int main(int argc, char **argv)
 {   
@@ -36,7 +64,25 @@ int main(int argc, char **argv)
     
     gettimeofday(&start, NULL); // start time of the program
 
-    float **grid, **newgrid;
+    int option;
+    while ((option = getopt(argc, argv, "n:i:")) != -1)
+    {
+        if (option == 'n')
+        {
+            parse_board_size(optarg);
+        }
+        else if (option == 'i' && atoi(optarg) >= 0)
+        {
+            number_of_iterations = atoi(optarg);
+        }
+        else
+        {
+            printf("Usage: %s [-n rows[xcolumns]] [-i iterations]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    Board grid, newgrid;
 
     // allocate memory for the board 
     grid = allocate_board();
@@ -69,176 +115,132 @@ int main(int argc, char **argv)
 }
 
 
-float** allocate_board()
+Board allocate_board()
 {
-    float ** grid;
-    
-    grid = (float **)malloc(board_size * sizeof(float *));
-    for (int i = 0; i < board_size; i++)
+    Board grid;
+    int floats_per_line = board_alignment / sizeof(float);
+
+    // padding + row + right ghost column, rounded up to whole cache lines
+    grid.stride = (board_padding + board_columns + 1 + floats_per_line - 1) / floats_per_line * floats_per_line;
+
+    // one aligned allocation for the whole board plus the two ghost rows
+    grid.slab = (float *)aligned_alloc(board_alignment, (size_t)(board_rows + 2) * grid.stride * sizeof(float));
+    if (grid.slab == NULL)
     {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+        printf("could not allocate the board\n");
+        exit(1);
     }
+    grid.cells = grid.slab + grid.stride + board_padding;
 
-    
     return grid;
 }
 
 
-void free_board(float **grid)
+void free_board(Board grid)
 {
     // free memory for the board
-    for (int i = 0; i < board_size; i++)
-    {
-        free(grid[i]);
-    }
-    free(grid);
+    free(grid.slab);
 }
 
 
-void initialize_board(float **grid)
+void initialize_board(Board grid)
 {   
     printf("initializing board...\n");
-    for(int i = 0; i < board_size; i++)
+    for(int i = 0; i < board_rows; i++)
     {
-        for(int j = 0; j < board_size; j++)
+        for(int j = 0; j < board_columns; j++)
         {
-            grid[i][j] = 0.0;
+            CELL(grid, i, j) = 0.0;
         }
     }
     printf("board cleared\n");
 
     // initialize the board from position (1,1) with glider pattern
     // and a R-pentomino pattern in (10, 30)
-    grid[1][2] = 1.0;
-    grid[2][3] = 1.0;
-    grid[3][1] = 1.0;
-    grid[3][2] = 1.0;
-    grid[3][3] = 1.0;
-
-    grid[10][31] = 1.0;
-    grid[10][32] = 1.0;
-    grid[11][30] = 1.0;
-    grid[11][31] = 1.0;
-    grid[12][31] = 1.0;
+    CELL(grid, 1, 2) = 1.0;
+    CELL(grid, 2, 3) = 1.0;
+    CELL(grid, 3, 1) = 1.0;
+    CELL(grid, 3, 2) = 1.0;
+    CELL(grid, 3, 3) = 1.0;
+
+    CELL(grid, 10, 31) = 1.0;
+    CELL(grid, 10, 32) = 1.0;
+    CELL(grid, 11, 30) = 1.0;
+    CELL(grid, 11, 31) = 1.0;
+    CELL(grid, 12, 31) = 1.0;
 
 }
 
-int get_neighbors(float **grid, int i, int j){
-    int number_of_neighbors = 0;
-
-    for(int k = i - 1; k <= i + 1; k++)
+// copy the opposite edges of the board into the ghost ring
+void update_ghost_cells(Board grid)
+{
+    // left and right ghost columns
+    for (int i = 0; i < board_rows; i++)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
-
-            int k_aux = k;
-            int l_aux = l;
-
-            if(k == i && l == j) // skip the cell itself
-            {
-                continue;
-            }
-            
-            // if the cell is in the border, get the value from the other side
-            if(k == -1) // if the cell is in the upper border
-            {
-                k_aux = board_size - 1;
-            }
-            else if (k == board_size) // if the cell is in the lower border
-            {
-                k_aux = 0;
-            }
-            
-            if(l == -1) // if the cell is in the left border
-            { 
-                l_aux = board_size - 1;
-            }
-            else if(l == board_size) // if the cell is in the right border
-            {
-                l_aux = 0;
-            }
-
-            // if the cell is alive, add to the number of neighbors
-            if(grid[k_aux][l_aux] > 0.0)
-            {   
-                number_of_neighbors++;
-            }
-        }
+        CELL(grid, i, -1) = CELL(grid, i, board_columns - 1);
+        CELL(grid, i, board_columns) = CELL(grid, i, 0);
     }
 
-    return number_of_neighbors;
+    // upper and lower ghost rows, corners included
+    memcpy(&CELL(grid, -1, -1), &CELL(grid, board_rows - 1, -1), (board_columns + 2) * sizeof(float));
+    memcpy(&CELL(grid, board_rows, -1), &CELL(grid, 0, -1), (board_columns + 2) * sizeof(float));
 }
 
-float average_neighbors_value(float** grid, int i,  int j){
-    float average = 0.0;
-    
-    for(int k = i - 1; k <= i + 1; k++)
+// compute row i of the next generation in a single pass.
+// The 3x3 window is kept as three vertical sums (live count and color sum
+// of columns j - 1, j and j + 1); moving one cell to the right reuses two of
+// them, so each cell loads only the three floats of column j + 1.
+void update_row(Board grid, Board newgrid, int i)
+{
+    const float *up = &CELL(grid, i - 1, 0);
+    const float *middle = &CELL(grid, i, 0);
+    const float *down = &CELL(grid, i + 1, 0);
+    float *next = &CELL(newgrid, i, 0);
+
+    // vertical sums of columns -1 and 0 (the ghost ring makes -1 valid)
+    int left_count = (up[-1] > 0.0) + (middle[-1] > 0.0) + (down[-1] > 0.0);
+    float left_sum = up[-1] + middle[-1] + down[-1];
+    int center_count = (up[0] > 0.0) + (middle[0] > 0.0) + (down[0] > 0.0);
+    float center_sum = up[0] + middle[0] + down[0];
+
+    for (int j = 0; j < board_columns; j++)
     {
-        for(int l = j - 1; l <= j + 1; l++)
-        {   
-
-            int k_aux = k;
-            int l_aux = l;
+        // vertical sums of the column entering the window
+        int right_count = (up[j + 1] > 0.0) + (middle[j + 1] > 0.0) + (down[j + 1] > 0.0);
+        float right_sum = up[j + 1] + middle[j + 1] + down[j + 1];
 
-            // same idea as get_neighbors function
-            if(k == -1)
-            {
-                k_aux = board_size - 1;
-            }
-            else if (k == board_size){
-                k_aux = 0;
-            }
+        int alive = middle[j] > 0.0;
+        int number_of_neighbors = left_count + center_count + right_count - alive;
 
-            if(l == -1){
-                l_aux = board_size - 1;
-            }
-            else if(l == board_size){
-                l_aux = 0;
-            }
-            
-            average += (float)grid[k_aux][l_aux];  
+        if (alive)
+        {
+            // survives with 2 or 3 neighbors
+            next[j] = (number_of_neighbors == 2 || number_of_neighbors == 3) ? 1.0 : 0.0;
+        }
+        else
+        {
+            // born with 3 neighbors, colored by the average of the 3x3 block
+            next[j] = (number_of_neighbors == 3) ? (left_sum + center_sum + right_sum) / (float)8.0 : 0.0;
         }
-    }
 
-    return (float)average / (float)8.0;
+        // slide the window one column to the right
+        left_count = center_count;
+        left_sum = center_sum;
+        center_count = right_count;
+        center_sum = right_sum;
+    }
 }
 
-void execute_iterations(float **grid , float **newgrid, int iterations)
+void execute_iterations(Board grid , Board newgrid, int iterations)
 {
     for(int i = 0; i < iterations; i++)
     {   
-        for(int j = 0; j < board_size; j++)
+        // refresh the ghost ring from the current generation
+        update_ghost_cells(grid);
+
+        for(int j = 0; j < board_rows; j++)
         {
-            for(int k = 0; k < board_size; k++)
-            {
-                
-                // get the number of neighbors of the cell
-                int number_of_neighbors = get_neighbors(grid, j, k);
-
-                // apply the rules of the game
-                if(grid[j][k] > 0.0)
-                {
-                    if(number_of_neighbors == 2 || number_of_neighbors == 3)
-                    {
-                        newgrid[j][k] = 1;
-                    }
-                    else
-                    {
-                        newgrid[j][k] = 0.0;
-                    }
-                }
-                else
-                {
-                    if(number_of_neighbors == 3)
-                    {   // calculate average of neighbors
-                        newgrid[j][k] = average_neighbors_value(grid, j, k);
-                    }
-                    else
-                    {
-                        newgrid[j][k] = 0.0;
-                    }
-                }   
-            }
+            update_row(grid, newgrid, j);
         }
         
         // print iteration
@@ -248,7 +250,7 @@ void execute_iterations(float **grid , float **newgrid, int iterations)
         compute_live_cells(grid);
 
         // swap grids for the next iteration
-        float** temp = grid;
+        Board temp = grid;
         grid = newgrid;
         newgrid = temp;
 
@@ -261,13 +263,36 @@ void execute_iterations(float **grid , float **newgrid, int iterations)
     compute_live_cells(grid);
 }
 
-void show_50_50_grid(float **grid)
+// function to read the board size from "rows" (a square board) or
+// "rowsxcolumns"; the initial patterns and the 50x50 corner printed for the
+// first generations need at least 50x50 cells
+void parse_board_size(const char *text)
+{
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if (fields == 1)
+    {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if (fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50)
+    {
+        printf("invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        exit(1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
+void show_50_50_grid(Board grid)
 {
     for(int i = 0; i < 50; i++)
     {
         for(int j = 0; j < 50; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 printf("@ ");
             }
@@ -281,14 +306,14 @@ void show_50_50_grid(float **grid)
     printf("\n");
 }
 
-void compute_live_cells(float **grid)
+void compute_live_cells(Board grid)
 {
     int live_cells = 0;
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 live_cells++;
             }
@@ -19,27 +19,63 @@
 // Including OpenMP for parallelization
 #include <omp.h>
 
-#define board_size 2048
-#define number_of_iterations 2000
+// size of the board and number of generations, set with -n and -i
+int board_rows = 2048;
+int board_columns = 2048;
+int number_of_iterations = 2000;
+
+// alignment (in bytes) of the board slab and of every row inside it
+#define board_alignment 64
+
+// board stored as one contiguous slab, row i starts at cells + i * stride
+typedef struct {
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board
+#define CELL(board, i, j) ((board).cells[(size_t)(i) * (board).stride + (j)])
 
 // function declarations
-float **allocate_board();
-void free_board(float **grid);
-void initialize_board(float **grid);
-void execute_iterations(float **grid, float **newgrid, int iterations);
-void compute_live_cells(float **grid);
-int get_neighbors(float **grid, int i, int j);
-float average_neighbors_value(float **grid, int i, int j);
+Board allocate_board();
+void free_board(Board grid);
+void initialize_board(Board grid);
+void execute_iterations(Board grid, Board newgrid, int iterations);
+void compute_live_cells(Board grid);
+int get_neighbors(Board grid, int i, int j);
+float average_neighbors_value(Board grid, int i, int j);
+int get_neighbors_masked(Board grid, int i, int j);
+float average_neighbors_value_masked(Board grid, int i, int j);
+int is_power_of_two(int n);
+void parse_board_size(const char *text);
 
 int main(int argc, char **argv)
 {
     struct timeval start, finish, begin, end;
     gettimeofday(&start, NULL);
 
+    int option;
+    while ((option = getopt(argc, argv, "n:i:")) != -1)
+    {
+        if (option == 'n')
+        {
+            parse_board_size(optarg);
+        }
+        else if (option == 'i' && atoi(optarg) >= 0)
+        {
+            number_of_iterations = atoi(optarg);
+        }
+        else
+        {
+            printf("Usage: %s [-n rows[xcolumns]] [-i iterations]\n", argv[0]);
+            exit(1);
+        }
+    }
+
     omp_set_nested(1);
     printf("Número máximo de threads: %d\n", omp_get_max_threads());
 
-    float **grid, **newgrid; // board and new board
+    Board grid, newgrid; // board and new board
 
     grid = allocate_board();    // allocate board
     newgrid = allocate_board(); // allocate new board
@@ -70,66 +106,64 @@ int main(int argc, char **argv)
 }
 
 // function to allocate board
-float **allocate_board()
+Board allocate_board()
 {
-    float **grid;
+    Board grid;
+    int floats_per_line = board_alignment / sizeof(float);
 
-    // allocate memory for the board
-    grid = (float **)malloc(board_size * sizeof(float *));
+    // round the row length up to a whole number of cache lines
+    grid.stride = (board_columns + floats_per_line - 1) / floats_per_line * floats_per_line;
 
-#pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
+    // one aligned allocation for the whole board
+    grid.cells = (float *)aligned_alloc(board_alignment, (size_t)board_rows * grid.stride * sizeof(float));
+    if (grid.cells == NULL)
     {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+        printf("could not allocate the board\n");
+        exit(1);
     }
 
     return grid;
 }
 
 // function to free board
-void free_board(float **grid)
+void free_board(Board grid)
 {
-// free memory for the board
-#pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
-    {
-        free(grid[i]);
-    }
-    free(grid);
+    // free memory for the board
+    free(grid.cells);
 }
 
 // function to initialize board
-void initialize_board(float **grid)
+void initialize_board(Board grid)
 {
     printf("initializing board...\n");
 // clear the board
 #pragma omp parallel for
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            grid[i][j] = 0.0;
+            CELL(grid, i, j) = 0.0;
         }
     }
     printf("board cleared\n");
 
     // initialize the board from position (1,1) with glider pattern
     // and a R-pentomino pattern in (10, 30)
-    grid[1][2] = 1.0;
-    grid[2][3] = 1.0;
-    grid[3][1] = 1.0;
-    grid[3][2] = 1.0;
-    grid[3][3] = 1.0;
-
-    grid[10][31] = 1.0;
-    grid[10][32] = 1.0;
-    grid[11][30] = 1.0;
-    grid[11][31] = 1.0;
-    grid[12][31] = 1.0;
+    CELL(grid, 1, 2) = 1.0;
+    CELL(grid, 2, 3) = 1.0;
+    CELL(grid, 3, 1) = 1.0;
+    CELL(grid, 3, 2) = 1.0;
+    CELL(grid, 3, 3) = 1.0;
+
+    CELL(grid, 10, 31) = 1.0;
+    CELL(grid, 10, 32) = 1.0;
+    CELL(grid, 11, 30) = 1.0;
+    CELL(grid, 11, 31) = 1.0;
+    CELL(grid, 12, 31) = 1.0;
 }
 
 // function to get number of neighbors
-int get_neighbors(float **grid, int i, int j)
+int get_neighbors(Board grid, int i, int j)
 {
     // get number of neighbors
     int number_of_neighbors = 0;
@@ -150,23 +184,23 @@ int get_neighbors(float **grid, int i, int j)
 
             if (k == -1) // if k is -1, then k_aux is the last position of the board
             {
-                k_aux = board_size - 1;
+                k_aux = board_rows - 1;
             }
-            else if (k == board_size) // if k is board_size, then k_aux is the first position of the board
+            else if (k == board_rows) // if k is board_rows, then k_aux is the first position of the board
             {
                 k_aux = 0;
             }
 
             if (l == -1) // if l is -1, then l_aux is the last position of the board
             {
-                l_aux = board_size - 1;
+                l_aux = board_columns - 1;
             }
-            else if (l == board_size) // if l is board_size, then l_aux is the first position of the board
+            else if (l == board_columns) // if l is board_columns, then l_aux is the first position of the board
             {
                 l_aux = 0;
             }
 
-            if (grid[k_aux][l_aux] > 0.0) // if neighbor is alive, then increment number of neighbors
+            if (CELL(grid, k_aux, l_aux) > 0.0) // if neighbor is alive, then increment number of neighbors
             {
                 number_of_neighbors++;
             }
@@ -177,7 +211,7 @@ int get_neighbors(float **grid, int i, int j)
 }
 
 // function to get average of neighbors
-float average_neighbors_value(float **grid, int i, int j)
+float average_neighbors_value(Board grid, int i, int j)
 {
     float average = 0.0;
 
@@ -192,64 +226,137 @@ float average_neighbors_value(float **grid, int i, int j)
 
             if (k == -1)
             {
-                k_aux = board_size - 1;
+                k_aux = board_rows - 1;
             }
-            else if (k == board_size)
+            else if (k == board_rows)
             {
                 k_aux = 0;
             }
 
             if (l == -1)
             {
-                l_aux = board_size - 1;
+                l_aux = board_columns - 1;
             }
-            else if (l == board_size)
+            else if (l == board_columns)
             {
                 l_aux = 0;
             }
 
-            average += (float)grid[k_aux][l_aux];
+            average += (float)CELL(grid, k_aux, l_aux);
+        }
+    }
+
+    return (float)average / (float)8.0;
+}
+
+// function to get number of neighbors on a board with power of two sides:
+// the indexes wrap around with a mask instead of being compared to the edges
+int get_neighbors_masked(Board grid, int i, int j)
+{
+    int number_of_neighbors = 0;
+
+    for (int k = i - 1; k <= i + 1; k++)
+    {
+        for (int l = j - 1; l <= j + 1; l++)
+        {
+            if (k == i && l == j) // skip current cell if it is not a neighbor
+            {
+                continue;
+            }
+
+            if (CELL(grid, k & (board_rows - 1), l & (board_columns - 1)) > 0.0)
+            {
+                number_of_neighbors++;
+            }
+        }
+    }
+
+    return number_of_neighbors;
+}
+
+// function to get average of neighbors on a board with power of two sides
+float average_neighbors_value_masked(Board grid, int i, int j)
+{
+    float average = 0.0;
+
+    for (int k = i - 1; k <= i + 1; k++)
+    {
+        for (int l = j - 1; l <= j + 1; l++)
+        {
+            average += (float)CELL(grid, k & (board_rows - 1), l & (board_columns - 1));
         }
     }
 
     return (float)average / (float)8.0;
 }
 
+// function to tell whether n is a power of two
+int is_power_of_two(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// function to read the board size from "rows" (a square board) or
+// "rowsxcolumns"; the initial patterns and the 50x50 corner printed for the
+// first generations need at least 50x50 cells
+void parse_board_size(const char *text)
+{
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if (fields == 1)
+    {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if (fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50)
+    {
+        printf("invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        exit(1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
 // function to execute iterations
-void execute_iterations(float **grid, float **newgrid, int iterations)
+void execute_iterations(Board grid, Board newgrid, int iterations)
 {
+    // boards with power of two sides wrap the neighbor indexes with masks
+    int power_of_two = is_power_of_two(board_rows) && is_power_of_two(board_columns);
+
     for (int i = 0; i < iterations; i++)
     {
 #pragma omp parallel for collapse(2) // collapse to parallelize nested for loops
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_rows; j++)
         {
 
-            for (int k = 0; k < board_size; k++)
+            for (int k = 0; k < board_columns; k++)
             {
 
                 // get neighbors
-                int number_of_neighbors = get_neighbors(grid, j, k);
+                int number_of_neighbors = power_of_two ? get_neighbors_masked(grid, j, k) : get_neighbors(grid, j, k);
 
-                if (grid[j][k] > 0.0)
+                if (CELL(grid, j, k) > 0.0)
                 {
                     if (number_of_neighbors == 2 || number_of_neighbors == 3)
                     {
-                        newgrid[j][k] = 1;
+                        CELL(newgrid, j, k) = 1;
                     }
                     else
                     {
-                        newgrid[j][k] = 0.0;
+                        CELL(newgrid, j, k) = 0.0;
                     }
                 }
                 else
                 {
                     if (number_of_neighbors == 3)
                     { // calculate average of neighbors
-                        newgrid[j][k] = average_neighbors_value(grid, j, k);
+                        CELL(newgrid, j, k) = power_of_two ? average_neighbors_value_masked(grid, j, k) : average_neighbors_value(grid, j, k);
                     }
                     else
                     {
-                        newgrid[j][k] = 0.0;
+                        CELL(newgrid, j, k) = 0.0;
                     }
                 }
             }
@@ -262,7 +369,7 @@ void execute_iterations(float **grid, float **newgrid, int iterations)
         compute_live_cells(grid);
 
         // swap grids
-        float **temp = grid;
+        Board temp = grid;
         grid = newgrid;
         newgrid = temp;
 
@@ -271,15 +378,15 @@ void execute_iterations(float **grid, float **newgrid, int iterations)
 }
 
 // function to compute live cells
-void compute_live_cells(float **grid)
+void compute_live_cells(Board grid)
 {
     int live_cells = 0;
 #pragma omp critical
-    for (int i = 0; i < board_size; i++)
+    for (int i = 0; i < board_rows; i++)
     {
-        for (int j = 0; j < board_size; j++)
+        for (int j = 0; j < board_columns; j++)
         {
-            if (grid[i][j] > 0.0)
+            if (CELL(grid, i, j) > 0.0)
             {
                 live_cells++;
             }
@@ -1,105 +1,725 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <mpi.h>
 
-#define board_size 2048
-#define number_of_iterations 2000
+// OpenMP directives, left out of the builds without -fopenmp; the clock
+// that every thread reads to time its own share of a generation
+#ifdef _OPENMP
+#include <omp.h>
+#define OMP_PRAGMA(directive) _Pragma(#directive)
+#define thread_clock() omp_get_wtime()
+#else
+#define OMP_PRAGMA(directive)
+#define thread_clock() MPI_Wtime()
+#endif
 
-float** allocate_subboard(int rows);
-void free_subboard(float **grid, int rows);
-void initialize_subboard(float **grid, int start_row, int rows);
-void execute_iterations(float **grid, float **newgrid, int start_row, int rows, int rank, int size);
-int get_neighbors(float **grid, int i, int j, int rows);
-float average_neighbors_value(float **grid, int i, int j, int rows);
-void compute_live_cells(float **grid, int rows);
+// size of the board and number of generations, set with -n and -i
+int board_rows = 2048;
+int board_columns = 2048;
+int number_of_iterations = 2000;
+
+// alignment (in bytes) of the sub-board slab and of every row inside it
+#define board_alignment 64
+
+// rule of the game as masks over the number of live neighbors: a dead cell
+// with n neighbors is born when bit n of birth_rule is set, a live one
+// survives when bit n of survival_rule is set (B3/S23)
+#define birth_rule (1 << 3)
+#define survival_rule ((1 << 2) | (1 << 3))
+
+// The board is saved to checkpoint_path (-o) at the end of the run and
+// every checkpoint_interval generations (-c); -l restarts from such a file,
+// on any number of ranks, and runs up to generation number_of_iterations
+const char *checkpoint_path = NULL;
+int checkpoint_interval = 0;
+const char *restart_path = NULL;
+
+// A checkpoint file starts with this header and goes on with the whole
+// board, row after row of floats
+typedef struct {
+    char magic[8];
+    int rows;
+    int columns;
+    int generation;
+    int birth;
+    int survival;
+} CheckpointHeader;
+
+#define checkpoint_magic "GOLCKPT"
+
+// width of the ghost ring, set with -w: the borders are exchanged every
+// halo_width generations and in between each rank recomputes the part of
+// the ring that is still valid, trading messages for redundant work
+int halo_width = 1;
+
+// Every balance_interval generations (-b, 0: never) the block boundaries
+// move so that the ranks spend about the same time computing; they stay
+// where they are while the slowest process row and column of the grid are
+// within balance_tolerance of the mean
+int balance_interval = 0;
+#define balance_tolerance 1.1
+
+// How the rings are filled, set with -x: "messages" sends every border
+// band with non-blocking point-to-point calls while the interior is
+// computed, "sendrecv" with blocking MPI_Sendrecv calls before it, "rma"
+// puts the bands straight into the rings of the neighbors through a window
+// (post/start/complete/wait epochs), and "shared" lets the ranks of a node
+// read the borders of each other from a shared memory window and only sends
+// messages to the ranks on other nodes; "compressed" sends every band in
+// the smallest of three encodings (see encode_band)
+const char *halo_transport = "messages";
+
+// forms of an encoded band, in the first int of the message; the second
+// one is the number of live cells
+#define band_empty 0
+#define band_sparse 1
+#define band_dense 2
+
+// a live cell in a sparse band: its index in the band, row after row
+typedef struct {
+    int index;
+    float color;
+} LiveCell;
+
+// The ranks form a periodic 2D grid and each one owns a block of the board.
+// Process row r of the grid owns board rows row_bounds[r] up to
+// row_bounds[r + 1] - 1, and likewise for the columns, so the blocks can
+// be resized by moving the bounds. The block keeps its place in the grid,
+// the ranks of its eight neighbors (indexed like directions below), the
+// row stride of its sub-boards and the datatypes of the border bands
+// (halo_width rows, halo_width columns and a halo_width square corner),
+// used to exchange them without copying. With the shared transport it also
+// keeps the ranks of its node, the window holding the two sub-boards of
+// each of them and the node rank of every neighbor (MPI_UNDEFINED for the
+// neighbors on other nodes). With the rma transport the window holds the
+// two sub-boards of every rank, and the block keeps the group of its
+// neighbors and the datatype of the part of their rings each band goes to.
+// With the compressed transport it keeps a send and a receive buffer per
+// direction, large enough for the dense form of the band.
+typedef struct {
+    MPI_Comm comm;
+    MPI_Comm node;
+    MPI_Win window;
+    int node_neighbors[8];
+    MPI_Group neighbor_group;
+    MPI_Datatype target_bands[8];
+    char *send_buffers[8];
+    char *receive_buffers[8];
+    int dims[2];
+    int coords[2];
+    int *row_bounds;
+    int *column_bounds;
+    int rows;
+    int columns;
+    int start_row;
+    int start_column;
+    int neighbors[8];
+    int stride;
+    MPI_Datatype row_band;
+    MPI_Datatype column_band;
+    MPI_Datatype corner;
+} Domain;
+
+// the eight neighbors of a block, as (row, column) offsets in the grid;
+// direction 7 - d is the opposite of direction d
+const int directions[8][2] = {
+    {-1, -1}, {-1, 0}, {-1, 1},
+    {0, -1},           {0, 1},
+    {1, -1},  {1, 0},  {1, 1}
+};
+
+// A sub-board is a single contiguous slab: row i starts at cells + i * stride,
+// with the stride rounded up to a full cache line. The block of the rank
+// starts at cell (halo_width, halo_width) and is surrounded by a ghost ring
+// holding the borders of the neighbors, so the update never wraps around.
+typedef struct {
+    float *cells;
+    int stride;
+} Board;
+
+// access cell (i, j) of a board
+#define CELL(board, i, j) ((board).cells[(size_t)(i) * (board).stride + (j)])
+
+// population of the generation read by the update and how it changes into
+// the generation it writes, counted while the new generation is computed;
+// color adds up the values of the live cells
+typedef struct {
+    int live;
+    int births;
+    int deaths;
+    double color;
+} Population;
+
+// sample the population of the whole board every report_interval
+// generations (0: only at the end)
+int report_interval = 1;
+
+Domain create_domain(MPI_Comm comm);
+void place_block(Domain *domain);
+void free_block(Domain *domain);
+void free_domain(Domain *domain);
+void split_extent(int length, int parts, int part, int *start, int *count);
+int balance_bounds(const int *bounds, int parts, const double *loads, int *new_bounds);
+int rebalance(Board *grid, Board *newgrid, Domain *domain, double load);
+MPI_Datatype create_piece_type(Domain *domain, int first_row, int rows, int first_column, int columns);
+void migrate_blocks(Board from, Domain *old, Board to, Domain *new);
+Board allocate_subboard(Domain domain);
+void free_subboard(Board grid);
+int subboard_stride(int columns);
+void allocate_boards(Domain *domain, Board *grid, Board *newgrid);
+void free_boards(Domain *domain, Board grid, Board newgrid);
+void copy_shared_borders(Board grid, Domain domain);
+void initialize_subboard(Board grid, Domain domain);
+void execute_iterations(Board *grid_pointer, Board *newgrid_pointer, Domain *domain_pointer, int first_generation);
+long exchange_borders(Board grid, Domain domain, MPI_Request *requests);
+void finish_borders(Board grid, Domain domain, MPI_Request *requests);
+int band_capacity(Domain domain, int d);
+int encode_band(Board grid, int i, int j, int height, int width, char *buffer);
+void decode_band(const char *buffer, Board grid, int i, int j, int height, int width);
+void put_borders(Board grid, Domain domain);
+void band_start(int d, int rows, int columns, int *ghost_i, int *ghost_j, int *border_i, int *border_j);
+MPI_Datatype band_type(Domain domain, int d);
+void neighbor_block(Domain domain, int d, int *rows, int *columns);
+int get_neighbors(Board grid, int i, int j);
+float average_neighbors_value(Board grid, int i, int j);
+void update_row(Board grid, Board newgrid, int i, int first, int last, Population *population);
+void update_region(Board grid, Board newgrid, Domain domain, int top, int bottom, int left, int right, Population *population);
+void parse_board_size(const char *text);
+void report_population(int i, Population population, double halo_bytes);
+void start_statistics(Population population, long halo_bytes, double *local, double *global, MPI_Comm comm, MPI_Request *request);
+Population finish_statistics(double *global, double *halo_bytes, MPI_Request *request);
+int read_checkpoint_header(const char *path);
+void create_file_types(Domain domain, MPI_Datatype *memory, MPI_Datatype *file);
+void write_checkpoint(const char *path, Board grid, Domain domain, int generation);
+void read_checkpoint(const char *path, Board grid, Domain domain);
 
 int main(int argc, char **argv)
 {
-    int rank, size;
+    int rank, size, provided;
 
-    MPI_Init(&argc, &argv);
+    // Built with -fopenmp every rank updates its block with an OpenMP team;
+    // only the master thread calls MPI, while the others compute
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+        fprintf(stderr, "the MPI library does not support MPI_THREAD_FUNNELED\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int rows_per_process = board_size / size;
-    int extra_rows = board_size % size;
-    int start_row = rank * rows_per_process;
-    int rows = (rank < extra_rows) ? rows_per_process + 1 : rows_per_process;
+    // only rank 0 reports the bad options, here and in getopt
+    int option;
+    opterr = (rank == 0);
+    while ((option = getopt(argc, argv, "r:n:i:w:o:c:l:b:x:")) != -1) {
+        if (option == 'r' && atoi(optarg) >= 0) {
+            report_interval = atoi(optarg);
+        } else if (option == 'n') {
+            parse_board_size(optarg);
+        } else if (option == 'i' && atoi(optarg) >= 0) {
+            number_of_iterations = atoi(optarg);
+        } else if (option == 'w' && atoi(optarg) >= 1) {
+            halo_width = atoi(optarg);
+        } else if (option == 'o') {
+            checkpoint_path = optarg;
+        } else if (option == 'c' && atoi(optarg) >= 0) {
+            checkpoint_interval = atoi(optarg);
+        } else if (option == 'l') {
+            restart_path = optarg;
+        } else if (option == 'b' && atoi(optarg) >= 0) {
+            balance_interval = atoi(optarg);
+        } else if (option == 'x') {
+            halo_transport = optarg;
+        } else {
+            if (rank == 0) {
+                fprintf(stderr, "Usage: %s [-n rows[xcolumns]] [-i iterations] [-r report interval] [-w halo width] "
+                                "[-x messages|sendrecv|rma|shared|compressed] [-b balance interval] "
+                                "[-o checkpoint file] [-c checkpoint interval] [-l restart file]\n", argv[0]);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    if (strcmp(halo_transport, "messages") != 0 && strcmp(halo_transport, "sendrecv") != 0 &&
+        strcmp(halo_transport, "rma") != 0 && strcmp(halo_transport, "shared") != 0 &&
+        strcmp(halo_transport, "compressed") != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "unknown halo transport %s, it must be messages, sendrecv, rma, shared or compressed\n", halo_transport);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (checkpoint_interval > 0 && checkpoint_path == NULL) {
+        if (rank == 0) {
+            fprintf(stderr, "checkpoints every %d generations need a file, given with -o\n", checkpoint_interval);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-    float **grid = allocate_subboard(rows);
-    float **newgrid = allocate_subboard(rows);
+    // a restart takes the board size and the generation from the file
+    int first_generation = 0;
+    if (restart_path != NULL) {
+        first_generation = read_checkpoint_header(restart_path);
+        if (first_generation >= number_of_iterations) {
+            if (rank == 0) {
+                fprintf(stderr, "%s is already at generation %d\n", restart_path, first_generation);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Arrange the ranks in a periodic 2D grid, as square as possible, so
+    // the board is a torus and the borders shrink with the blocks
+    int dims[2] = {0, 0};
+    int periods[2] = {1, 1};
+    MPI_Dims_create(size, 2, dims);
+    if (dims[0] > board_rows || dims[1] > board_columns) {
+        if (rank == 0) {
+            fprintf(stderr, "a %dx%d process grid does not fit a %dx%d board\n", dims[0], dims[1], board_rows, board_columns);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // the ring of a block is filled from the blocks around it, which must
+    // be at least halo_width cells thick
+    if (halo_width < 1 || halo_width > board_rows / dims[0] || halo_width > board_columns / dims[1]) {
+        if (rank == 0) {
+            fprintf(stderr, "invalid halo width %d, it must be between 1 and the smallest block side\n", halo_width);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-    initialize_subboard(grid, start_row, rows);
+    MPI_Comm cart;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &cart);
+    Domain domain = create_domain(cart);
+
+    Board grid, newgrid;
+    allocate_boards(&domain, &grid, &newgrid);
+
+    initialize_subboard(grid, domain);
+    if (restart_path != NULL) {
+        read_checkpoint(restart_path, grid, domain);
+    }
 
     double start_time = MPI_Wtime();
-    execute_iterations(grid, newgrid, start_row, rows, rank, size);
+    execute_iterations(&grid, &newgrid, &domain, first_generation);
     double end_time = MPI_Wtime();
 
     if (rank == 0) {
         printf("Total time: %f seconds\n", end_time - start_time);
     }
 
-    free_subboard(grid, rows);
-    free_subboard(newgrid, rows);
+    free_boards(&domain, grid, newgrid);
+    free_domain(&domain);
 
     MPI_Finalize();
     return 0;
 }
 
-float** allocate_subboard(int rows) {
-    float **grid = (float **)malloc((rows + 2) * sizeof(float *)); // Allocate 2 extra rows
-    for (int i = 0; i < rows + 2; i++) {
-        grid[i] = (float *)malloc(board_size * sizeof(float));
+// find the place of this rank in the process grid and its neighbors, and
+// start with blocks of the same size
+Domain create_domain(MPI_Comm comm) {
+    Domain domain;
+    int periods[2], count;
+
+    domain.comm = comm;
+    MPI_Cart_get(comm, 2, domain.dims, periods, domain.coords);
+
+    domain.row_bounds = (int *)malloc((domain.dims[0] + 1) * sizeof(int));
+    domain.column_bounds = (int *)malloc((domain.dims[1] + 1) * sizeof(int));
+    for (int r = 0; r <= domain.dims[0]; r++) {
+        split_extent(board_rows, domain.dims[0], r, &domain.row_bounds[r], &count);
     }
-    return grid;
+    for (int c = 0; c <= domain.dims[1]; c++) {
+        split_extent(board_columns, domain.dims[1], c, &domain.column_bounds[c], &count);
+    }
+
+    // the grid is periodic, so MPI_Cart_rank wraps the coordinates
+    for (int d = 0; d < 8; d++) {
+        int neighbor[2] = {domain.coords[0] + directions[d][0], domain.coords[1] + directions[d][1]};
+        MPI_Cart_rank(comm, neighbor, &domain.neighbors[d]);
+        domain.node_neighbors[d] = MPI_UNDEFINED;
+    }
+
+    // with the shared transport, find which neighbors share our node
+    domain.node = MPI_COMM_NULL;
+    domain.window = MPI_WIN_NULL;
+    if (strcmp(halo_transport, "shared") == 0) {
+        MPI_Group group, node_group;
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &domain.node);
+        MPI_Comm_group(comm, &group);
+        MPI_Comm_group(domain.node, &node_group);
+        MPI_Group_translate_ranks(group, 8, domain.neighbors, node_group, domain.node_neighbors);
+        MPI_Group_free(&group);
+        MPI_Group_free(&node_group);
+    }
+
+    // with the rma transport, the group of the neighbors (each one once)
+    // for the post/start epochs
+    domain.neighbor_group = MPI_GROUP_NULL;
+    if (strcmp(halo_transport, "rma") == 0) {
+        MPI_Group group;
+        int ranks[8], count = 0;
+        for (int d = 0; d < 8; d++) {
+            int seen = 0;
+            for (int k = 0; k < count; k++) {
+                seen |= ranks[k] == domain.neighbors[d];
+            }
+            if (!seen) {
+                ranks[count++] = domain.neighbors[d];
+            }
+        }
+        MPI_Comm_group(comm, &group);
+        MPI_Group_incl(group, count, ranks, &domain.neighbor_group);
+        MPI_Group_free(&group);
+    }
+
+    place_block(&domain);
+    return domain;
+}
+
+// take the block of this rank from the bounds and lay out its sub-boards
+void place_block(Domain *domain) {
+    domain->start_row = domain->row_bounds[domain->coords[0]];
+    domain->rows = domain->row_bounds[domain->coords[0] + 1] - domain->start_row;
+    domain->start_column = domain->column_bounds[domain->coords[1]];
+    domain->columns = domain->column_bounds[domain->coords[1] + 1] - domain->start_column;
+
+    domain->stride = subboard_stride(domain->columns);
+
+    // every band takes a few consecutive floats from consecutive rows
+    MPI_Type_vector(halo_width, domain->columns, domain->stride, MPI_FLOAT, &domain->row_band);
+    MPI_Type_vector(domain->rows, halo_width, domain->stride, MPI_FLOAT, &domain->column_band);
+    MPI_Type_vector(halo_width, halo_width, domain->stride, MPI_FLOAT, &domain->corner);
+    MPI_Type_commit(&domain->row_band);
+    MPI_Type_commit(&domain->column_band);
+    MPI_Type_commit(&domain->corner);
+
+    // the part of the ring of the neighbor facing d that our band facing d
+    // goes to, laid out with the stride of the neighbor
+    for (int d = 0; d < 8; d++) {
+        domain->target_bands[d] = MPI_DATATYPE_NULL;
+        domain->send_buffers[d] = NULL;
+        domain->receive_buffers[d] = NULL;
+        if (strcmp(halo_transport, "compressed") == 0) {
+            domain->send_buffers[d] = (char *)malloc(band_capacity(*domain, d));
+            domain->receive_buffers[d] = (char *)malloc(band_capacity(*domain, d));
+        }
+        if (domain->neighbor_group == MPI_GROUP_NULL) continue;
+
+        int rows, columns;
+        neighbor_block(*domain, d, &rows, &columns);
+        int height = (directions[d][0] == 0) ? domain->rows : halo_width;
+        int width = (directions[d][1] == 0) ? domain->columns : halo_width;
+        MPI_Type_vector(height, width, subboard_stride(columns), MPI_FLOAT, &domain->target_bands[d]);
+        MPI_Type_commit(&domain->target_bands[d]);
+    }
+}
+
+void free_block(Domain *domain) {
+    MPI_Type_free(&domain->row_band);
+    MPI_Type_free(&domain->column_band);
+    MPI_Type_free(&domain->corner);
+    for (int d = 0; d < 8; d++) {
+        if (domain->target_bands[d] != MPI_DATATYPE_NULL) {
+            MPI_Type_free(&domain->target_bands[d]);
+        }
+        free(domain->send_buffers[d]);
+        free(domain->receive_buffers[d]);
+    }
+}
+
+void free_domain(Domain *domain) {
+    free_block(domain);
+    free(domain->row_bounds);
+    free(domain->column_bounds);
+    if (domain->node != MPI_COMM_NULL) {
+        MPI_Comm_free(&domain->node);
+    }
+    if (domain->neighbor_group != MPI_GROUP_NULL) {
+        MPI_Group_free(&domain->neighbor_group);
+    }
+    MPI_Comm_free(&domain->comm);
+}
+
+// split length cells in parts blocks whose sizes differ by at most one and
+// give the first cell and the size of block part
+void split_extent(int length, int parts, int part, int *start, int *count) {
+    int base = length / parts;
+    int extra = length % parts;
+
+    *start = part * base + (part < extra ? part : extra);
+    *count = (part < extra) ? base + 1 : base;
+}
+
+// place the bounds of parts intervals between bounds[0] and bounds[parts]
+// (which stay where they are) so that each one
+// gets the same share of the load, taking the load of an interval as spread
+// evenly over its cells and keeping every interval at least halo_width
+// cells thick; gives whether any bound moved
+int balance_bounds(const int *bounds, int parts, const double *loads, int *new_bounds) {
+    double total = 0.0;
+    double largest = 0.0;
+
+    memcpy(new_bounds, bounds, (parts + 1) * sizeof(int));
+    for (int p = 0; p < parts; p++) {
+        total += loads[p];
+        largest = (loads[p] > largest) ? loads[p] : largest;
+    }
+    if (total <= 0.0 || largest <= balance_tolerance * total / parts) {
+        return 0;
+    }
+
+    int p = 0;
+    double before = 0.0;
+    for (int k = 1; k < parts; k++) {
+        // find the interval where the load reaches k parts of the total
+        double target = total * k / parts;
+        while (p < parts - 1 && before + loads[p] < target) {
+            before += loads[p];
+            p++;
+        }
+        double per_cell = loads[p] / (bounds[p + 1] - bounds[p]);
+        new_bounds[k] = bounds[p] + ((per_cell > 0.0) ? (int)((target - before) / per_cell + 0.5) : 0);
+    }
+
+    for (int k = 1; k < parts; k++) {
+        if (new_bounds[k] < new_bounds[k - 1] + halo_width) {
+            new_bounds[k] = new_bounds[k - 1] + halo_width;
+        }
+    }
+    for (int k = parts - 1; k > 0; k--) {
+        if (new_bounds[k] > new_bounds[k + 1] - halo_width) {
+            new_bounds[k] = new_bounds[k + 1] - halo_width;
+        }
+    }
+
+    return memcmp(new_bounds, bounds, (parts + 1) * sizeof(int)) != 0;
 }
 
+// Move the block bounds so that the process rows and the process columns
+// of the grid take about the same compute time, from the time every rank
+// spent since the last call, and migrate the cells to their new owners.
+// Gives whether the blocks changed; the rings are then out of date.
+int rebalance(Board *grid, Board *newgrid, Domain *domain, double load) {
+    int rank;
+    int parts = domain->dims[0] + domain->dims[1];
+    double *loads = (double *)calloc(parts, sizeof(double));
+    double *totals = (double *)calloc(parts, sizeof(double));
+    int *bounds = (int *)malloc((parts + 3) * sizeof(int));
+
+    // rank 0 adds up the load of every process row and column, so all the
+    // ranks get the very same bounds from it
+    MPI_Comm_rank(domain->comm, &rank);
+    loads[domain->coords[0]] = load;
+    loads[domain->dims[0] + domain->coords[1]] = load;
+    MPI_Reduce(loads, totals, parts, MPI_DOUBLE, MPI_SUM, 0, domain->comm);
+
+    int *row_bounds = bounds + 1;
+    int *column_bounds = bounds + domain->dims[0] + 2;
+    if (rank == 0) {
+        bounds[0] = balance_bounds(domain->row_bounds, domain->dims[0], totals, row_bounds);
+        bounds[0] |= balance_bounds(domain->column_bounds, domain->dims[1], totals + domain->dims[0], column_bounds);
+    }
+    MPI_Bcast(bounds, parts + 3, MPI_INT, 0, domain->comm);
+
+    int changed = bounds[0];
+    if (changed) {
+        Domain old = *domain;
+        domain->row_bounds = (int *)malloc((domain->dims[0] + 1) * sizeof(int));
+        domain->column_bounds = (int *)malloc((domain->dims[1] + 1) * sizeof(int));
+        memcpy(domain->row_bounds, row_bounds, (domain->dims[0] + 1) * sizeof(int));
+        memcpy(domain->column_bounds, column_bounds, (domain->dims[1] + 1) * sizeof(int));
+        place_block(domain);
+
+        Board moved, moved_newgrid;
+        allocate_boards(domain, &moved, &moved_newgrid);
+        migrate_blocks(*grid, &old, moved, domain);
 
-void free_subboard(float **grid, int rows) {
-    for (int i = 0; i < rows; i++) {
-        free(grid[i]);
+        free_boards(&old, *grid, *newgrid);
+        *grid = moved;
+        *newgrid = moved_newgrid;
+
+        free_block(&old);
+        free(old.row_bounds);
+        free(old.column_bounds);
     }
-    free(grid);
+
+    free(loads);
+    free(totals);
+    free(bounds);
+    return changed;
 }
 
-void initialize_subboard(float **grid, int start_row, int rows) {
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < board_size; j++) {
-            grid[i][j] = 0.0;
+// the cells of board rows first_row.. and columns first_column.. inside a
+// sub-board of this rank
+MPI_Datatype create_piece_type(Domain *domain, int first_row, int rows, int first_column, int columns) {
+    MPI_Datatype type;
+    int sizes[2] = {domain->rows + 2 * halo_width, domain->stride};
+    int piece_sizes[2] = {rows, columns};
+    int starts[2] = {first_row - domain->start_row + halo_width, first_column - domain->start_column + halo_width};
+
+    MPI_Type_create_subarray(2, sizes, piece_sizes, starts, MPI_ORDER_C, MPI_FLOAT, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+// move the cells from the old blocks to the new ones: every rank sends each
+// rank the piece of its old block that lies in the new block of that rank,
+// which after a small move of the bounds is only its neighbors
+void migrate_blocks(Board from, Domain *old, Board to, Domain *new) {
+    int size;
+    MPI_Comm_size(old->comm, &size);
+
+    int *send_counts = (int *)calloc(size, sizeof(int));
+    int *receive_counts = (int *)calloc(size, sizeof(int));
+    int *displacements = (int *)calloc(size, sizeof(int));
+    MPI_Datatype *send_types = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+    MPI_Datatype *receive_types = (MPI_Datatype *)malloc(size * sizeof(MPI_Datatype));
+
+    for (int q = 0; q < size; q++) {
+        int coords[2];
+        MPI_Cart_coords(old->comm, q, 2, coords);
+        send_types[q] = MPI_FLOAT;
+        receive_types[q] = MPI_FLOAT;
+
+        // our old block against the new block of q
+        int top = old->start_row > new->row_bounds[coords[0]] ? old->start_row : new->row_bounds[coords[0]];
+        int bottom = old->start_row + old->rows < new->row_bounds[coords[0] + 1] ? old->start_row + old->rows : new->row_bounds[coords[0] + 1];
+        int left = old->start_column > new->column_bounds[coords[1]] ? old->start_column : new->column_bounds[coords[1]];
+        int right = old->start_column + old->columns < new->column_bounds[coords[1] + 1] ? old->start_column + old->columns : new->column_bounds[coords[1] + 1];
+        if (top < bottom && left < right) {
+            send_types[q] = create_piece_type(old, top, bottom - top, left, right - left);
+            send_counts[q] = 1;
+        }
+
+        // the old block of q against our new block
+        top = old->row_bounds[coords[0]] > new->start_row ? old->row_bounds[coords[0]] : new->start_row;
+        bottom = old->row_bounds[coords[0] + 1] < new->start_row + new->rows ? old->row_bounds[coords[0] + 1] : new->start_row + new->rows;
+        left = old->column_bounds[coords[1]] > new->start_column ? old->column_bounds[coords[1]] : new->start_column;
+        right = old->column_bounds[coords[1] + 1] < new->start_column + new->columns ? old->column_bounds[coords[1] + 1] : new->start_column + new->columns;
+        if (top < bottom && left < right) {
+            receive_types[q] = create_piece_type(new, top, bottom - top, left, right - left);
+            receive_counts[q] = 1;
         }
     }
 
-    // Initialize with specific patterns only if they fall within this subboard
-    if (start_row <= 1 && start_row + rows > 1) {
-        // Glider pattern
-        grid[1 - start_row][2] = 1.0;
-        grid[2 - start_row][3] = 1.0;
-        grid[3 - start_row][1] = 1.0;
-        grid[3 - start_row][2] = 1.0;
-        grid[3 - start_row][3] = 1.0;
+    MPI_Alltoallw(from.cells, send_counts, displacements, send_types,
+                  to.cells, receive_counts, displacements, receive_types, old->comm);
+
+    for (int q = 0; q < size; q++) {
+        if (send_counts[q] > 0) {
+            MPI_Type_free(&send_types[q]);
+        }
+        if (receive_counts[q] > 0) {
+            MPI_Type_free(&receive_types[q]);
+        }
     }
+    free(send_counts);
+    free(receive_counts);
+    free(displacements);
+    free(send_types);
+    free(receive_types);
+}
+
+Board allocate_subboard(Domain domain) {
+    Board grid;
 
-    if (start_row <= 10 && start_row + rows > 10) {
-        // R-pentomino pattern
-        grid[10 - start_row][31] = 1.0;
-        grid[10 - start_row][32] = 1.0;
-        grid[11 - start_row][30] = 1.0;
-        grid[11 - start_row][31] = 1.0;
-        grid[12 - start_row][31] = 1.0;
+    grid.stride = domain.stride;
+    grid.cells = (float *)aligned_alloc(board_alignment, (size_t)(domain.rows + 2 * halo_width) * grid.stride * sizeof(float)); // Allocate the ghost ring
+    if (grid.cells == NULL) {
+        fprintf(stderr, "could not allocate the sub-board\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    return grid;
+}
+
+
+void free_subboard(Board grid) {
+    free(grid.cells);
+}
+
+// row stride of a sub-board whose block has this many columns: the block
+// and its ring, rounded up to a full cache line
+int subboard_stride(int columns) {
+    int floats_per_line = board_alignment / sizeof(float);
+    return (columns + 2 * halo_width + floats_per_line - 1) / floats_per_line * floats_per_line;
+}
+
+// allocate the two sub-boards of the block; with the shared and the rma
+// transports they go one after the other in the part of this rank of a
+// window, shared by the node (and kept open for direct loads and stores
+// until free_boards) or exposed to the neighbors
+void allocate_boards(Domain *domain, Board *grid, Board *newgrid) {
+    if (domain->node == MPI_COMM_NULL && domain->neighbor_group == MPI_GROUP_NULL) {
+        *grid = allocate_subboard(*domain);
+        *newgrid = allocate_subboard(*domain);
+        return;
+    }
+
+    size_t floats = (size_t)(domain->rows + 2 * halo_width) * domain->stride;
+    float *cells;
+    if (domain->node != MPI_COMM_NULL) {
+        MPI_Info info;
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Win_allocate_shared(2 * floats * sizeof(float), sizeof(float), info, domain->node, &cells, &domain->window);
+        MPI_Info_free(&info);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, domain->window);
+    } else {
+        MPI_Win_allocate(2 * floats * sizeof(float), sizeof(float), MPI_INFO_NULL, domain->comm, &cells, &domain->window);
+    }
+
+    grid->cells = cells;
+    grid->stride = domain->stride;
+    newgrid->cells = cells + floats;
+    newgrid->stride = domain->stride;
 }
 
-int get_neighbors(float **grid, int i, int j, int rows) {
+void free_boards(Domain *domain, Board grid, Board newgrid) {
+    if (domain->window == MPI_WIN_NULL) {
+        free_subboard(grid);
+        free_subboard(newgrid);
+        return;
+    }
+
+    if (domain->node != MPI_COMM_NULL) {
+        MPI_Win_unlock_all(domain->window);
+    }
+    MPI_Win_free(&domain->window);
+}
+
+void initialize_subboard(Board grid, Domain domain) {
+    for (int i = 0; i < domain.rows + 2 * halo_width; i++) {
+        for (int j = 0; j < domain.columns + 2 * halo_width; j++) {
+            CELL(grid, i, j) = 0.0;
+        }
+    }
+
+    // Glider pattern from (1, 1) and R-pentomino pattern in (10, 30), in
+    // board coordinates; each rank sets the cells that fall in its block
+    int pattern[][2] = {
+        {1, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3},
+        {10, 31}, {10, 32}, {11, 30}, {11, 31}, {12, 31}
+    };
+    for (int p = 0; p < (int)(sizeof(pattern) / sizeof(pattern[0])); p++) {
+        int i = pattern[p][0] - domain.start_row;
+        int j = pattern[p][1] - domain.start_column;
+        if (i >= 0 && i < domain.rows && j >= 0 && j < domain.columns) {
+            CELL(grid, i + halo_width, j + halo_width) = 1.0;
+        }
+    }
+}
+
+int get_neighbors(Board grid, int i, int j) {
     int number_of_neighbors = 0;
 
     for (int k = i - 1; k <= i + 1; k++) {
         for (int l = j - 1; l <= j + 1; l++) {
             if (k == i && l == j) continue;
 
-            int k_aux = (k < 0) ? rows - 1 : (k >= rows) ? 0 : k;
-            int l_aux = (l < 0) ? board_size - 1 : (l >= board_size) ? 0 : l;
-
-            if (grid[k_aux][l_aux] > 0.0) {
+            if (CELL(grid, k, l) > 0.0) {
                 number_of_neighbors++;
             }
         }
@@ -108,76 +728,644 @@ int get_neighbors(float **grid, int i, int j, int rows) {
     return number_of_neighbors;
 }
 
-float average_neighbors_value(float **grid, int i, int j, int rows) {
+float average_neighbors_value(Board grid, int i, int j) {
     float average = 0.0;
 
     for (int k = i - 1; k <= i + 1; k++) {
         for (int l = j - 1; l <= j + 1; l++) {
-            int k_aux = (k < 0) ? rows - 1 : (k >= rows) ? 0 : k;
-            int l_aux = (l < 0) ? board_size - 1 : (l >= board_size) ? 0 : l;
-
-            average += grid[k_aux][l_aux];
+            average += CELL(grid, k, l);
         }
     }
 
     return average / 8.0;
 }
 
-void compute_live_cells(float **grid, int rows) {
-    int live_cells = 0;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < board_size; j++) {
-            if (grid[i][j] > 0.0) {
-                live_cells++;
+// read the board size from "rows" (a square board) or "rowsxcolumns"; the
+// initial patterns need at least 50x50 cells
+void parse_board_size(const char *text) {
+    // %n gives how much of the text was read, which must be all of it
+    int rows, columns, consumed = 0;
+    int fields = sscanf(text, "%dx%d%n", &rows, &columns, &consumed);
+    if (fields == 1) {
+        sscanf(text, "%d%n", &rows, &consumed);
+        columns = rows;
+    }
+    if (fields < 1 || text[consumed] != '\0' || rows < 50 || columns < 50) {
+        fprintf(stderr, "invalid board size %s, it must be rows or rowsxcolumns with at least 50x50 cells\n", text);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    board_rows = rows;
+    board_columns = columns;
+}
+
+void report_population(int i, Population population, double halo_bytes) {
+    double mean_color = (population.live > 0) ? population.color / population.live : 0.0;
+    printf("iteration: %d live cells: %d births: %d deaths: %d mean color: %f halo bytes: %.0f\n", i, population.live, population.births, population.deaths, mean_color, halo_bytes);
+}
+
+// start adding up the population of every block and the bytes every rank
+// sent to fill the rings; the buffers belong to the reduction until
+// finish_statistics, so the compute loop goes on meanwhile
+void start_statistics(Population population, long halo_bytes, double *local, double *global, MPI_Comm comm, MPI_Request *request) {
+    local[0] = population.live;
+    local[1] = population.births;
+    local[2] = population.deaths;
+    local[3] = population.color;
+    local[4] = halo_bytes;
+    MPI_Iallreduce(local, global, 5, MPI_DOUBLE, MPI_SUM, comm, request);
+}
+
+// wait for the reduction started by start_statistics and give the population
+// of the whole board and the halo bytes of the generation
+Population finish_statistics(double *global, double *halo_bytes, MPI_Request *request) {
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+    *halo_bytes = global[4];
+    return (Population){(int)global[0], (int)global[1], (int)global[2], global[3]};
+}
+
+// compute columns first..last of row i of the next generation, counting the
+// population on the way instead of sweeping the sub-board again
+void update_row(Board grid, Board newgrid, int i, int first, int last, Population *population) {
+    for (int j = first; j <= last; j++) {
+        int num_neighbors = get_neighbors(grid, i, j);
+        float cell = CELL(grid, i, j);
+
+        // Game of Life rules
+        if (cell > 0.0) {
+            // Cell is alive: It remains alive with 2 or 3 neighbors
+            int survives = (survival_rule >> num_neighbors) & 1;
+            CELL(newgrid, i, j) = survives ? 1.0 : 0.0;
+            population->live++;
+            population->deaths += !survives;
+            population->color += cell;
+        } else {
+            // Cell is dead: It becomes alive if exactly 3 neighbors are alive
+            int born = (birth_rule >> num_neighbors) & 1;
+            CELL(newgrid, i, j) = born ? average_neighbors_value(grid, i, j) : 0.0;
+            population->births += born;
+        }
+    }
+}
+
+// compute rows top..bottom and columns left..right of the next generation;
+// only the cells of the block count in the population, the others are the
+// part of the ring recomputed for the generations before the next exchange
+void update_region(Board grid, Board newgrid, Domain domain, int top, int bottom, int left, int right, Population *population) {
+    Population ring = {0, 0, 0, 0.0};
+    int last_row = halo_width + domain.rows - 1;
+    int last_column = halo_width + domain.columns - 1;
+    int block_left = (left > halo_width) ? left : halo_width;
+    int block_right = (right < last_column) ? right : last_column;
+
+    for (int i = top; i <= bottom; i++) {
+        if (i < halo_width || i > last_row) {
+            update_row(grid, newgrid, i, left, right, &ring);
+        } else {
+            update_row(grid, newgrid, i, left, block_left - 1, &ring);
+            update_row(grid, newgrid, i, block_left, block_right, population);
+            update_row(grid, newgrid, i, block_right + 1, right, &ring);
+        }
+    }
+}
+
+// where the ring facing direction d and the border band facing d start in
+// a sub-board whose block has rows x columns cells
+void band_start(int d, int rows, int columns, int *ghost_i, int *ghost_j, int *border_i, int *border_j) {
+    int di = directions[d][0];
+    int dj = directions[d][1];
+
+    *ghost_i = (di < 0) ? 0 : (di > 0) ? halo_width + rows : halo_width;
+    *ghost_j = (dj < 0) ? 0 : (dj > 0) ? halo_width + columns : halo_width;
+    *border_i = (di > 0) ? rows : halo_width;
+    *border_j = (dj > 0) ? columns : halo_width;
+}
+
+// datatype of the border band (and of the ring) facing direction d
+MPI_Datatype band_type(Domain domain, int d) {
+    return (directions[d][0] == 0) ? domain.column_band : (directions[d][1] == 0) ? domain.row_band : domain.corner;
+}
+
+// size of the block of the neighbor in direction d, from the bounds of the grid
+void neighbor_block(Domain domain, int d, int *rows, int *columns) {
+    int r = (domain.coords[0] + directions[d][0] + domain.dims[0]) % domain.dims[0];
+    int c = (domain.coords[1] + directions[d][1] + domain.dims[1]) % domain.dims[1];
+
+    *rows = domain.row_bounds[r + 1] - domain.row_bounds[r];
+    *columns = domain.column_bounds[c + 1] - domain.column_bounds[c];
+}
+
+// bytes for the dense form of the band facing direction d
+int band_capacity(Domain domain, int d) {
+    int height = (directions[d][0] == 0) ? domain.rows : halo_width;
+    int width = (directions[d][1] == 0) ? domain.columns : halo_width;
+    return 2 * sizeof(int) + height * width * sizeof(float);
+}
+
+// Encode the band of height x width cells from (i, j) in the smallest of
+// three forms: empty when no cell is alive, sparse with the index and the
+// color of every live cell, or dense with every cell; gives its size in bytes
+int encode_band(Board grid, int i, int j, int height, int width, char *buffer) {
+    int *header = (int *)buffer;
+    int live = 0;
+
+    for (int k = 0; k < height; k++) {
+        for (int l = 0; l < width; l++) {
+            live += CELL(grid, i + k, j + l) > 0.0;
+        }
+    }
+
+    header[1] = live;
+    if (live == 0) {
+        header[0] = band_empty;
+        return 2 * sizeof(int);
+    }
+
+    if (live * sizeof(LiveCell) < height * width * sizeof(float)) {
+        LiveCell *cells = (LiveCell *)(header + 2);
+        int count = 0;
+        header[0] = band_sparse;
+        for (int k = 0; k < height; k++) {
+            for (int l = 0; l < width; l++) {
+                if (CELL(grid, i + k, j + l) > 0.0) {
+                    cells[count++] = (LiveCell){k * width + l, CELL(grid, i + k, j + l)};
+                }
             }
         }
+        return 2 * sizeof(int) + live * sizeof(LiveCell);
     }
-    printf("live cells: %d\n", live_cells);
+
+    float *cells = (float *)(header + 2);
+    header[0] = band_dense;
+    for (int k = 0; k < height; k++) {
+        memcpy(cells + k * width, &CELL(grid, i + k, j), width * sizeof(float));
+    }
+    return 2 * sizeof(int) + height * width * sizeof(float);
 }
 
-void execute_iterations(float **grid, float **newgrid, int start_row, int rows, int rank, int size) {
+// write a band encoded by encode_band into the height x width cells from (i, j)
+void decode_band(const char *buffer, Board grid, int i, int j, int height, int width) {
+    const int *header = (const int *)buffer;
 
+    if (header[0] == band_dense) {
+        const float *cells = (const float *)(header + 2);
+        for (int k = 0; k < height; k++) {
+            memcpy(&CELL(grid, i + k, j), cells + k * width, width * sizeof(float));
+        }
+        return;
+    }
 
-    MPI_Status status;
+    for (int k = 0; k < height; k++) {
+        memset(&CELL(grid, i + k, j), 0, width * sizeof(float));
+    }
+    if (header[0] == band_sparse) {
+        const LiveCell *cells = (const LiveCell *)(header + 2);
+        for (int c = 0; c < header[1]; c++) {
+            CELL(grid, i + cells[c].index / width, j + cells[c].index % width) = cells[c].color;
+        }
+    }
+}
+
+// Start the exchange of the ghost ring with the eight neighbors, to be
+// completed by finish_borders, and give the bytes sent. With messages the
+// border band of the block facing direction d is sent with tag d and lands
+// in the ring of the neighbor facing back, which receives with tag 7 - d
+// (the tag tells the directions apart when a neighbor appears more than once)
+long exchange_borders(Board grid, Domain domain, MPI_Request *requests) {
+    int ghost_i, ghost_j, border_i, border_j, size;
+    long sent = 0;
 
-    for (int iter = 0; iter < number_of_iterations; iter++) {
-        // Send and receive border rows
-        if (rank > 0) {
-            MPI_Sendrecv(grid[1], board_size, MPI_FLOAT, rank - 1, 0,
-                         grid[0], board_size, MPI_FLOAT, rank - 1, 0,
-                         MPI_COMM_WORLD, &status);
+    for (int r = 0; r < 16; r++) {
+        requests[r] = MPI_REQUEST_NULL;
+    }
+
+    if (strcmp(halo_transport, "rma") == 0) {
+        put_borders(grid, domain);
+        for (int d = 0; d < 8; d++) {
+            MPI_Type_size(band_type(domain, d), &size);
+            sent += size;
         }
-        if (rank < size - 1) {
-            MPI_Sendrecv(grid[rows], board_size, MPI_FLOAT, rank + 1, 0,
-                         grid[rows + 1], board_size, MPI_FLOAT, rank + 1, 0,
-                         MPI_COMM_WORLD, &status);
+        return sent;
+    }
+
+    // the receiver decodes the band in finish_borders, from the buffer
+    // sized for the dense form
+    if (strcmp(halo_transport, "compressed") == 0) {
+        for (int d = 0; d < 8; d++) {
+            int height = (directions[d][0] == 0) ? domain.rows : halo_width;
+            int width = (directions[d][1] == 0) ? domain.columns : halo_width;
+            band_start(d, domain.rows, domain.columns, &ghost_i, &ghost_j, &border_i, &border_j);
+            size = encode_band(grid, border_i, border_j, height, width, domain.send_buffers[d]);
+            MPI_Irecv(domain.receive_buffers[d], band_capacity(domain, d), MPI_BYTE, domain.neighbors[d], 7 - d, domain.comm, &requests[d]);
+            MPI_Isend(domain.send_buffers[d], size, MPI_BYTE, domain.neighbors[d], d, domain.comm, &requests[8 + d]);
+            sent += size;
+        }
+        return sent;
+    }
+
+    // every rank sends its band facing d and receives the band coming from
+    // the opposite side at the same time, so the calls always pair up
+    if (strcmp(halo_transport, "sendrecv") == 0) {
+        for (int d = 0; d < 8; d++) {
+            int opposite_i, opposite_j, unused_i, unused_j;
+            band_start(d, domain.rows, domain.columns, &ghost_i, &ghost_j, &border_i, &border_j);
+            band_start(7 - d, domain.rows, domain.columns, &opposite_i, &opposite_j, &unused_i, &unused_j);
+            MPI_Sendrecv(&CELL(grid, border_i, border_j), 1, band_type(domain, d), domain.neighbors[d], d,
+                         &CELL(grid, opposite_i, opposite_j), 1, band_type(domain, 7 - d), domain.neighbors[7 - d], d,
+                         domain.comm, MPI_STATUS_IGNORE);
+            MPI_Type_size(band_type(domain, d), &size);
+            sent += size;
         }
+        return sent;
+    }
+
+    for (int d = 0; d < 8; d++) {
+        // the neighbors on this node fill the ring in copy_shared_borders
+        if (domain.node_neighbors[d] != MPI_UNDEFINED) continue;
+
+        band_start(d, domain.rows, domain.columns, &ghost_i, &ghost_j, &border_i, &border_j);
+        MPI_Irecv(&CELL(grid, ghost_i, ghost_j), 1, band_type(domain, d), domain.neighbors[d], 7 - d, domain.comm, &requests[d]);
+        MPI_Isend(&CELL(grid, border_i, border_j), 1, band_type(domain, d), domain.neighbors[d], d, domain.comm, &requests[8 + d]);
+        MPI_Type_size(band_type(domain, d), &size);
+        sent += size;
+    }
+
+    if (domain.node != MPI_COMM_NULL) {
+        copy_shared_borders(grid, domain);
+    }
+    return sent;
+}
+
+// wait until the ring started by exchange_borders is complete
+void finish_borders(Board grid, Domain domain, MPI_Request *requests) {
+    MPI_Waitall(16, requests, MPI_STATUSES_IGNORE);
+
+    if (domain.send_buffers[0] != NULL) {
+        for (int d = 0; d < 8; d++) {
+            int ghost_i, ghost_j, border_i, border_j;
+            int height = (directions[d][0] == 0) ? domain.rows : halo_width;
+            int width = (directions[d][1] == 0) ? domain.columns : halo_width;
+            band_start(d, domain.rows, domain.columns, &ghost_i, &ghost_j, &border_i, &border_j);
+            decode_band(domain.receive_buffers[d], grid, ghost_i, ghost_j, height, width);
+        }
+    }
+
+    if (domain.neighbor_group != MPI_GROUP_NULL) {
+        MPI_Win_complete(domain.window);
+        MPI_Win_wait(domain.window);
+    }
+}
+
+// Put the border bands straight into the rings of the neighbors. Posting
+// our window lets the neighbors put into it, and no neighbor can do so
+// before we post, once done with the previous generation; the epochs are
+// closed by finish_borders. The ranks swap their sub-boards in step, so the
+// one a neighbor is reading sits at the same place in its part of the
+// window as ours.
+void put_borders(Board grid, Domain domain) {
+    float *own;
+    int flag;
+
+    MPI_Win_get_attr(domain.window, MPI_WIN_BASE, &own, &flag);
+    int current = (grid.cells != own);
+
+    MPI_Win_post(domain.neighbor_group, 0, domain.window);
+    MPI_Win_start(domain.neighbor_group, 0, domain.window);
+
+    for (int d = 0; d < 8; d++) {
+        int rows, columns, ghost_i, ghost_j, border_i, border_j, unused_i, unused_j;
+        neighbor_block(domain, d, &rows, &columns);
+
+        // our band facing d goes to the ring of the neighbor facing back
+        int stride = subboard_stride(columns);
+        band_start(d, domain.rows, domain.columns, &unused_i, &unused_j, &border_i, &border_j);
+        band_start(7 - d, rows, columns, &ghost_i, &ghost_j, &unused_i, &unused_j);
+        MPI_Aint target = (MPI_Aint)current * (rows + 2 * halo_width) * stride + (MPI_Aint)ghost_i * stride + ghost_j;
+
+        MPI_Put(&CELL(grid, border_i, border_j), 1, band_type(domain, d), domain.neighbors[d],
+                target, 1, domain.target_bands[d], domain.window);
+    }
+}
+
+// Fill the ring from the neighbors on this node, loading their border bands
+// straight from their sub-boards in the shared window. The ranks swap their
+// sub-boards in step, so the one a neighbor is reading sits at the same
+// place in its segment as ours. A barrier makes sure the node finished the
+// previous generation before the copy; with a deeper ring a second one keeps
+// the neighbors from writing that sub-board again (halo_width generations
+// later, without any exchange in between) before we are done reading it.
+void copy_shared_borders(Board grid, Domain domain) {
+    int node_rank, disp_unit;
+    MPI_Aint segment_size;
+    float *own;
+
+    MPI_Comm_rank(domain.node, &node_rank);
+    MPI_Win_shared_query(domain.window, node_rank, &segment_size, &disp_unit, &own);
+    int current = (grid.cells != own);
+
+    MPI_Win_sync(domain.window);
+    MPI_Barrier(domain.node);
+    MPI_Win_sync(domain.window);
+
+    for (int d = 0; d < 8; d++) {
+        if (domain.node_neighbors[d] == MPI_UNDEFINED) continue;
 
-        // Perform Game of Life iteration on each cell of the sub-board
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < board_size; j++) {
-                int num_neighbors = get_neighbors(grid, i, j, rows);
-                float cell = grid[i][j];
+        int rows, columns, ghost_i, ghost_j, border_i, border_j, unused_i, unused_j;
+        neighbor_block(domain, d, &rows, &columns);
 
-                // Game of Life rules
-                if (cell > 0.0) {
-                    // Cell is alive: It remains alive with 2 or 3 neighbors
-                    newgrid[i][j] = (num_neighbors == 2 || num_neighbors == 3) ? 1.0 : 0.0;
-                } else {
-                    // Cell is dead: It becomes alive if exactly 3 neighbors are alive
-                    newgrid[i][j] = (num_neighbors == 3) ? average_neighbors_value(grid, i, j, rows) : 0.0;
+        float *cells;
+        MPI_Win_shared_query(domain.window, domain.node_neighbors[d], &segment_size, &disp_unit, &cells);
+        Board neighbor;
+        neighbor.stride = subboard_stride(columns);
+        neighbor.cells = cells + (size_t)current * (rows + 2 * halo_width) * neighbor.stride;
+
+        // its band facing back at us lands in our ring facing d
+        int height = (directions[d][0] == 0) ? domain.rows : halo_width;
+        int width = (directions[d][1] == 0) ? domain.columns : halo_width;
+        band_start(d, domain.rows, domain.columns, &ghost_i, &ghost_j, &unused_i, &unused_j);
+        band_start(7 - d, rows, columns, &unused_i, &unused_j, &border_i, &border_j);
+
+        for (int k = 0; k < height; k++) {
+            memcpy(&CELL(grid, ghost_i + k, ghost_j), &CELL(neighbor, border_i + k, border_j), width * sizeof(float));
+        }
+    }
+
+    if (halo_width > 1) {
+        MPI_Barrier(domain.node);
+    }
+}
+
+// run the generations; the blocks can move (see rebalance), so the final
+// sub-boards and domain go back to the caller
+void execute_iterations(Board *grid_pointer, Board *newgrid_pointer, Domain *domain_pointer, int first_generation) {
+    Board grid = *grid_pointer;
+    Board newgrid = *newgrid_pointer;
+    Domain domain = *domain_pointer;
+    Population population = {0, 0, 0, 0.0};
+    int rank;
+
+    // time spent computing since the last rebalance: every thread times its
+    // own share of the update loops, and a generation counts the mean of
+    // the team, so the waits for the neighbors are left out
+    double load = 0.0;
+
+    // The sampled population of the whole board is combined with a
+    // non-blocking reduction, completed after the next generation so the
+    // collective never holds the compute loop. It also carries the bytes
+    // sent for the rings since the last sample, per generation
+    double local[5], global[5], halo_bytes;
+    MPI_Request statistics = MPI_REQUEST_NULL;
+    int sampled = -1;
+    long sent = 0;
+    int since_sample = 0;
+
+    MPI_Comm_rank(domain.comm, &rank);
+
+    // After an exchange the whole ring is valid; every generation computes
+    // one cell less of it, down to the block alone right before the next
+    // exchange, step generations after the last one
+    int step = 0;
+
+    for (int iter = first_generation; iter < number_of_iterations; iter++) {
+        int extent = halo_width - 1 - step;
+        int live = 0, births = 0, deaths = 0;
+        double color = 0.0;
+        double computing = 0.0;
+        int team = 0;
+
+        // first and last row and column of the block in the sub-boards
+        int first = halo_width;
+        int last_row = halo_width + domain.rows - 1;
+        int last_column = halo_width + domain.columns - 1;
+
+        // first row below the interior and first column right of it
+        int lower = (last_row > first) ? last_row : first + 1;
+        int rightmost = (last_column > first) ? last_column : first + 1;
+
+        if (step == 0) {
+            MPI_Request requests[16];
+
+            OMP_PRAGMA(omp parallel reduction(+:live, births, deaths, color, computing, team))
+            {
+                Population mine = {0, 0, 0, 0.0};
+                double loop_started;
+                team = 1;
+
+                // The master thread starts the exchange and joins the others
+                // on the interior of the block, which does not read the ring;
+                // once out of the interior it completes the exchange, and the
+                // team waits for it before going on. With one thread (or
+                // without OpenMP) this is start, interior, wait, border.
+                OMP_PRAGMA(omp master)
+                sent += exchange_borders(grid, domain, requests);
+
+                loop_started = thread_clock();
+                OMP_PRAGMA(omp for schedule(dynamic) nowait)
+                for (int i = first + 1; i < last_row; i++) {
+                    update_row(grid, newgrid, i, first + 1, last_column - 1, &mine);
                 }
+                computing += thread_clock() - loop_started;
+
+                OMP_PRAGMA(omp master)
+                finish_borders(grid, domain, requests);
+                OMP_PRAGMA(omp barrier)
+
+                // Then the border of the block and the ring around it: whole
+                // rows above and below the interior, the sides in between
+                loop_started = thread_clock();
+                OMP_PRAGMA(omp for schedule(dynamic) nowait)
+                for (int i = first - extent; i <= last_row + extent; i++) {
+                    if (i > first && i < lower) {
+                        update_region(grid, newgrid, domain, i, i, first - extent, first, &mine);
+                        update_region(grid, newgrid, domain, i, i, rightmost, last_column + extent, &mine);
+                    } else {
+                        update_region(grid, newgrid, domain, i, i, first - extent, last_column + extent, &mine);
+                    }
+                }
+                computing += thread_clock() - loop_started;
+
+                live += mine.live;
+                births += mine.births;
+                deaths += mine.deaths;
+                color += mine.color;
+            }
+        } else {
+            OMP_PRAGMA(omp parallel reduction(+:live, births, deaths, color, computing, team))
+            {
+                Population mine = {0, 0, 0, 0.0};
+                double loop_started = thread_clock();
+                team = 1;
+
+                OMP_PRAGMA(omp for nowait)
+                for (int i = first - extent; i <= last_row + extent; i++) {
+                    update_region(grid, newgrid, domain, i, i, first - extent, last_column + extent, &mine);
+                }
+                computing += thread_clock() - loop_started;
+
+                live += mine.live;
+                births += mine.births;
+                deaths += mine.deaths;
+                color += mine.color;
             }
         }
+        population = (Population){live, births, deaths, color};
+        load += computing / team;
+        step = (step + 1) % halo_width;
+        since_sample++;
 
         // Swap the old and new grids
-        float **temp = grid;
+        Board temp = grid;
         grid = newgrid;
         newgrid = temp;
 
-        // Lets just the rank 0 process do it
+        if (balance_interval > 0 && (iter + 1) % balance_interval == 0 && iter + 1 < number_of_iterations) {
+            if (rebalance(&grid, &newgrid, &domain, load)) {
+                step = 0;
+            }
+            load = 0.0;
+        }
+
+        // grid now holds generation iter + 1
+        if (checkpoint_path != NULL && ((checkpoint_interval > 0 && (iter + 1) % checkpoint_interval == 0) || iter + 1 == number_of_iterations)) {
+            write_checkpoint(checkpoint_path, grid, domain, iter + 1);
+        }
+
+        // The reduction of the last sample had this generation to finish
+        if (sampled >= 0) {
+            Population total = finish_statistics(global, &halo_bytes, &statistics);
+            if (rank == 0)
+            report_population(sampled, total, halo_bytes);
+            sampled = -1;
+        }
+        if (report_interval > 0 && iter % report_interval == 0) {
+            start_statistics(population, sent / since_sample, local, global, domain.comm, &statistics);
+            sampled = iter;
+            sent = 0;
+            since_sample = 0;
+        }
+
+    }
+
+    if (sampled >= 0) {
+        Population total = finish_statistics(global, &halo_bytes, &statistics);
         if (rank == 0)
-        compute_live_cells(grid, rows);
+        report_population(sampled, total, halo_bytes);
+    }
+
+    // the last generation, counted over the whole board; with no generation
+    // to run (-i 0) the block is counted as it was given, and saved as is
+    int live_cells = population.live + population.births - population.deaths;
+    if (first_generation == number_of_iterations) {
+        live_cells = 0;
+        for (int i = 0; i < domain.rows; i++) {
+            for (int j = 0; j < domain.columns; j++) {
+                live_cells += CELL(grid, i + halo_width, j + halo_width) > 0.0;
+            }
+        }
+        if (checkpoint_path != NULL) {
+            write_checkpoint(checkpoint_path, grid, domain, first_generation);
+        }
+    }
+    int total_live_cells;
+    MPI_Reduce(&live_cells, &total_live_cells, 1, MPI_INT, MPI_SUM, 0, domain.comm);
+    if (rank == 0)
+    printf("live cells: %d\n", total_live_cells);
+
+    *grid_pointer = grid;
+    *newgrid_pointer = newgrid;
+    *domain_pointer = domain;
+}
+
+// read the header of a checkpoint, take the board size from it and give the
+// generation it was saved at
+int read_checkpoint_header(const char *path) {
+    MPI_File file;
+    CheckpointHeader header;
 
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        fprintf(stderr, "could not open the checkpoint %s\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+
+    if (memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0 || header.rows < 50 || header.columns < 50) {
+        fprintf(stderr, "%s is not a checkpoint\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (header.birth != birth_rule || header.survival != survival_rule) {
+        fprintf(stderr, "%s was saved with a different rule\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+
+    board_rows = header.rows;
+    board_columns = header.columns;
+    return header.generation;
+}
+
+// the block of a rank inside its sub-board (skipping the ring) and inside
+// the board stored in a checkpoint
+void create_file_types(Domain domain, MPI_Datatype *memory, MPI_Datatype *file) {
+    int subboard_sizes[2] = {domain.rows + 2 * halo_width, domain.stride};
+    int board_sizes[2] = {board_rows, board_columns};
+    int block_sizes[2] = {domain.rows, domain.columns};
+    int subboard_starts[2] = {halo_width, halo_width};
+    int board_starts[2] = {domain.start_row, domain.start_column};
+
+    MPI_Type_create_subarray(2, subboard_sizes, block_sizes, subboard_starts, MPI_ORDER_C, MPI_FLOAT, memory);
+    MPI_Type_create_subarray(2, board_sizes, block_sizes, board_starts, MPI_ORDER_C, MPI_FLOAT, file);
+    MPI_Type_commit(memory);
+    MPI_Type_commit(file);
+}
+
+// save the board: rank 0 writes the header and every rank writes its own
+// block straight from the sub-board, in a single collective call
+void write_checkpoint(const char *path, Board grid, Domain domain, int generation) {
+    MPI_File file;
+    MPI_Datatype memory, board;
+    int rank;
+
+    MPI_Comm_rank(domain.comm, &rank);
+    if (MPI_File_open(domain.comm, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        if (rank == 0) {
+            fprintf(stderr, "could not create the checkpoint %s\n", path);
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (rank == 0) {
+        CheckpointHeader header = {checkpoint_magic, board_rows, board_columns, generation, birth_rule, survival_rule};
+        MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    // drop whatever an older, larger file had past the board
+    MPI_File_set_size(file, sizeof(CheckpointHeader) + (MPI_Offset)board_rows * board_columns * sizeof(float));
+
+    create_file_types(domain, &memory, &board);
+    MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_FLOAT, board, "native", MPI_INFO_NULL);
+    MPI_File_write_at_all(file, 0, grid.cells, 1, memory, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+
+    MPI_Type_free(&memory);
+    MPI_Type_free(&board);
+}
+
+// load the block of every rank from a checkpoint, whatever the process grid
+// that saved it
+void read_checkpoint(const char *path, Board grid, Domain domain) {
+    MPI_File file;
+    MPI_Datatype memory, board;
+
+    if (MPI_File_open(domain.comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        fprintf(stderr, "could not open the checkpoint %s\n", path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    create_file_types(domain, &memory, &board);
+    MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_FLOAT, board, "native", MPI_INFO_NULL);
+    MPI_File_read_at_all(file, 0, grid.cells, 1, memory, MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+
+    MPI_Type_free(&memory);
+    MPI_Type_free(&board);
 }